@@ -1,9 +1,17 @@
 #ifndef AST_H
 #define AST_H
 
+#include <cstdint>
+#include <deque>
 #include <iostream>
 #include <memory>
 #include <map>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 // Forward declarations
@@ -15,6 +23,7 @@ struct Expression;
 struct UnaryExpression;
 struct BinaryExpression;
 struct Identifier;
+struct Cast;
 struct IntType;
 struct RealType;
 struct BoolType;
@@ -50,6 +59,7 @@ public:
     virtual void visit(ast::BoolLiteral *bl) = 0;
     virtual void visit(ast::VariableDeclaration *vardecl) = 0;
     virtual void visit(ast::Identifier *id) = 0;
+    virtual void visit(ast::Cast *cast) = 0;
     virtual void visit(ast::UnaryExpression *exp) = 0;
     virtual void visit(ast::BinaryExpression *exp) = 0;
     virtual void visit(ast::RoutineDeclaration *routine) = 0;
@@ -65,8 +75,86 @@ public:
 
 namespace ast {
 
-// Pointer to an AST node.
-template <typename Node> using node_ptr = std::shared_ptr<Node>;
+// Pointer to an AST node. Nodes are owned by the Arena of their Program.
+template <typename Node> using node_ptr = Node*;
+
+// Bump-pointer allocator owning every node of a program; all nodes are freed at once.
+class Arena {
+public:
+    Arena() {}
+    Arena(const Arena&) = delete;
+    Arena &operator=(const Arena&) = delete;
+
+    ~Arena() {
+        for (auto it = dtors.rbegin(); it != dtors.rend(); ++it) {
+            it->second(it->first);
+        }
+    }
+
+    template <typename T, typename... Args>
+    T *make(Args&&... args) {
+        T *obj = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value) {
+            dtors.emplace_back(obj, [](void *p) { static_cast<T*>(p)->~T(); });
+        }
+        return obj;
+    }
+
+private:
+    static const size_t SLAB_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> slabs;
+    std::vector<std::pair<void*, void(*)(void*)>> dtors;
+    char *cur = nullptr, *end = nullptr;
+
+    void *allocate(size_t size, size_t align) {
+        size_t pad = cur ? (align - reinterpret_cast<uintptr_t>(cur) % align) % align : 0;
+        if (!cur || pad + size > static_cast<size_t>(end - cur)) {
+            size_t slab_size = size + align > SLAB_SIZE ? size + align : SLAB_SIZE;
+            slabs.emplace_back(new char[slab_size]);
+            cur = slabs.back().get();
+            end = cur + slab_size;
+            pad = (align - reinterpret_cast<uintptr_t>(cur) % align) % align;
+        }
+        void *p = cur + pad;
+        cur += pad + size;
+        return p;
+    }
+};
+
+// Handle of an interned identifier. Equal names always get the same handle,
+// and handles are dense (0, 1, 2, ...) so they can index tables directly.
+using Symbol = uint32_t;
+constexpr Symbol NO_SYMBOL = UINT32_MAX;
+
+// Interns identifier names once (in the lexer) so later phases compare integers.
+// Lookups take a string_view, so interning a known name allocates nothing.
+class SymbolTable {
+public:
+    Symbol intern(std::string_view name) {
+        auto it = ids.find(name);
+        if (it != ids.end()) {
+            return it->second;
+        }
+        names.emplace_back(name); // deque elements never move, so keys stay valid
+        Symbol sym = static_cast<Symbol>(names.size() - 1);
+        ids.emplace(names.back(), sym);
+        return sym;
+    }
+
+    // Looks a name up without interning it; safe while other threads read the table.
+    Symbol find(std::string_view name) const {
+        auto it = ids.find(name);
+        return it != ids.end() ? it->second : NO_SYMBOL;
+    }
+
+    const std::string &name(Symbol sym) const { return names[sym]; }
+    size_t size() const { return names.size(); }
+
+private:
+    std::unordered_map<std::string_view, Symbol> ids;
+    std::deque<std::string> names;
+};
 
 // Enumerations
 enum class TypeEnum { INT, REAL, BOOL, ARRAY, RECORD };
@@ -79,16 +167,20 @@ struct Node {
 
 // A special node containing program variables, type aliases, and routines.
 struct Program : Node {
+    Arena arena; // owns every other node of the program
+    SymbolTable symbols;
     std::vector<node_ptr<VariableDeclaration>> variables;
-    std::map<std::string, node_ptr<Type>> types;
+    std::map<Symbol, node_ptr<Type>> types;
     std::vector<node_ptr<RoutineDeclaration>> routines;
+    std::unordered_map<Symbol, node_ptr<RoutineDeclaration>> routine_index;
+    std::vector<node_ptr<RoutineCall>> unresolved_calls; // calls parsed before their routine
     
     void accept(Visitor *v) override { v->visit(this); }
 };
 
 // Base class for Expressions
 struct Expression : Node {
-    node_ptr<Type> dtype;
+    node_ptr<Type> dtype = nullptr; // resolved by SemanticAnalyzer; nullptr for a procedure call
 };
 
 // Base class for Types
@@ -125,8 +217,8 @@ struct BoolType : Type {
 };
 
 struct ArrayType : Type {
-    node_ptr<Expression> size;
-    node_ptr<Type> dtype;
+    node_ptr<Expression> size = nullptr;
+    node_ptr<Type> dtype = nullptr;
     
     ArrayType(node_ptr<Expression> size, node_ptr<Type>dtype) {
         this->size = size;
@@ -139,7 +231,6 @@ struct ArrayType : Type {
 };
 
 struct RecordType : Type {
-    std::string name; // set by llvm vardecl or typedecl
     std::vector<node_ptr<VariableDeclaration>> fields;
     
     RecordType(std::vector<node_ptr<VariableDeclaration>> fields) {
@@ -151,10 +242,15 @@ struct RecordType : Type {
     void accept(Visitor *v) override { v->visit(this); }
 };
 
+// Shared instances of the primitive types, for expressions whose type is derived rather than declared
+inline node_ptr<Type> int_type() { static IntType type; return &type; }
+inline node_ptr<Type> real_type() { static RealType type; return &type; }
+inline node_ptr<Type> bool_type() { static BoolType type; return &type; }
+
 // </Types>
 // <Expressions>
 struct UnaryExpression : Expression {
-    node_ptr<Expression> operand;
+    node_ptr<Expression> operand = nullptr;
     OperatorEnum op;
 
     UnaryExpression(OperatorEnum op, node_ptr<Expression> operand) {
@@ -166,7 +262,7 @@ struct UnaryExpression : Expression {
 };
 
 struct BinaryExpression : Expression {
-    node_ptr<Expression> lhs, rhs;
+    node_ptr<Expression> lhs = nullptr, rhs = nullptr;
     OperatorEnum op;
 
     BinaryExpression(node_ptr<Expression> lhs, OperatorEnum op, node_ptr<Expression> rhs) {
@@ -182,7 +278,7 @@ struct IntLiteral : Expression {
     int64_t value;
 
     IntLiteral(int64_t value) {
-        this->dtype = std::make_shared<IntType>();
+        this->dtype = int_type();
         this->value = value;
     }
 
@@ -193,7 +289,7 @@ struct RealLiteral : Expression {
     double value;
 
     RealLiteral(double value) {
-        this->dtype = std::make_shared<RealType>();
+        this->dtype = real_type();
         this->value = value;
     }
 
@@ -204,7 +300,7 @@ struct BoolLiteral : Expression {
     bool value;
 
     BoolLiteral(bool value) {
-        this->dtype = std::make_shared<BoolType>();
+        this->dtype = bool_type();
         this->value = value;
     }
 
@@ -212,16 +308,17 @@ struct BoolLiteral : Expression {
 };
 
 struct Identifier : Expression {
-    std::string name;
-    node_ptr<Expression> idx;
+    Symbol name;
+    node_ptr<Expression> idx = nullptr;
+    bool check_bounds = true; // cleared when idx provably lies within the array (--bounds-check)
     
     // variable or record field access
-    Identifier(std::string name) {
+    Identifier(Symbol name) {
         this->name = name;
     }
     
     // array element access
-    Identifier(std::string name, node_ptr<Expression> idx) {
+    Identifier(Symbol name, node_ptr<Expression> idx) {
         this->name = name;
         this->idx = idx;
     }
@@ -229,26 +326,38 @@ struct Identifier : Expression {
     void accept(Visitor *v) override { v->visit(this); }
 };
 
+// Implicit conversion of operand to dtype, inserted by the semantic pass
+struct Cast : Expression {
+    node_ptr<Expression> operand = nullptr;
+
+    Cast(node_ptr<Expression> operand, node_ptr<Type> dtype) {
+        this->operand = operand;
+        this->dtype = dtype;
+    }
+
+    void accept(Visitor *v) override { v->visit(this); }
+};
+
 // </Expressions>
 // <Nodes>
 struct VariableDeclaration : Node {
-    std::string name;
-    node_ptr<Type> dtype;
-    node_ptr<Expression> initial_value;
+    Symbol name;
+    node_ptr<Type> dtype = nullptr;
+    node_ptr<Expression> initial_value = nullptr;
 
-    VariableDeclaration(std::string name, node_ptr<Type> dtype) {
+    VariableDeclaration(Symbol name, node_ptr<Type> dtype) {
         this->name = name;
         this->dtype = dtype;
         this->initial_value = nullptr;
     }
 
-    VariableDeclaration(std::string name, node_ptr<Expression> initial_value) {
+    VariableDeclaration(Symbol name, node_ptr<Expression> initial_value) {
         this->name = name;
         this->dtype = initial_value->dtype;
         this->initial_value = initial_value;
     }
 
-    VariableDeclaration(std::string name, node_ptr<Type> dtype, node_ptr<Expression> initial_value) {
+    VariableDeclaration(Symbol name, node_ptr<Type> dtype, node_ptr<Expression> initial_value) {
         this->name = name;
         this->dtype = dtype;
         this->initial_value = initial_value;
@@ -271,19 +380,20 @@ struct Body : Node {
 };
 
 struct RoutineDeclaration : Node {
-    std::string name;
+    Symbol name;
     std::vector<node_ptr<VariableDeclaration>> params;
-    node_ptr<Type> rtype;
-    node_ptr<Body> body;
+    node_ptr<Type> rtype = nullptr;
+    node_ptr<Body> body = nullptr; // nullptr: declared here, defined in another module
+    bool inline_hint = false; // declared "inline routine"
     
-    RoutineDeclaration(std::string name, std::vector<node_ptr<VariableDeclaration>> params, node_ptr<Body> body, node_ptr<Type> rtype) {
+    RoutineDeclaration(Symbol name, std::vector<node_ptr<VariableDeclaration>> params, node_ptr<Body> body, node_ptr<Type> rtype) {
         this->name = name;
         this->params = params;
         this->rtype = rtype;
         this->body = body;
     }
     
-    RoutineDeclaration(std::string name, std::vector<node_ptr<VariableDeclaration>> params, node_ptr<Body> body) {
+    RoutineDeclaration(Symbol name, std::vector<node_ptr<VariableDeclaration>> params, node_ptr<Body> body) {
         this->name = name;
         this->params = params;
         this->body = body;
@@ -295,7 +405,7 @@ struct RoutineDeclaration : Node {
 // </Nodes>
 // <Statements>
 struct ReturnStatement : Statement {
-    node_ptr<Expression> exp;
+    node_ptr<Expression> exp = nullptr;
     
     ReturnStatement() {}
 
@@ -307,8 +417,8 @@ struct ReturnStatement : Statement {
 };
 
 struct PrintStatement : Statement {
-    node_ptr<Expression> exp;
-    node_ptr<std::string> str;
+    node_ptr<Expression> exp = nullptr;
+    node_ptr<std::string> str = nullptr;
     bool endl;
 
     PrintStatement(node_ptr<Expression> exp, bool endl=false) {
@@ -325,8 +435,8 @@ struct PrintStatement : Statement {
 };
 
 struct AssignmentStatement : Statement {
-    node_ptr<Identifier> id;
-    node_ptr<Expression> exp;
+    node_ptr<Identifier> id = nullptr;
+    node_ptr<Expression> exp = nullptr;
 
     AssignmentStatement(node_ptr<Identifier> id, node_ptr<Expression> exp) {
         this->id = id;
@@ -337,8 +447,8 @@ struct AssignmentStatement : Statement {
 };
 
 struct IfStatement : Statement {
-    node_ptr<Expression> cond;
-    node_ptr<Body> then_body, else_body;
+    node_ptr<Expression> cond = nullptr;
+    node_ptr<Body> then_body = nullptr, else_body = nullptr;
 
     IfStatement(node_ptr<Expression> cond, node_ptr<Body> then_body) {
         this->cond = cond;
@@ -355,40 +465,48 @@ struct IfStatement : Statement {
 };
 
 struct WhileLoop : Statement {
-    node_ptr<Expression> cond;
-    node_ptr<Body> body;
+    node_ptr<Expression> cond = nullptr;
+    node_ptr<Body> body = nullptr;
+    size_t offset = 0; // of the while keyword in the source
 
-    WhileLoop(node_ptr<Expression> cond, node_ptr<Body> body) {
+    WhileLoop(node_ptr<Expression> cond, node_ptr<Body> body, size_t offset = 0) {
         this->cond = cond;
         this->body = body;
+        this->offset = offset;
     }
 
     void accept(Visitor *v) override { v->visit(this); }
 };
 
+// for loop_var in [reverse] from .. to loop body end
 struct ForLoop : Statement {
-    node_ptr<VariableDeclaration> loop_var;
-    node_ptr<Expression> cond;
-    node_ptr<Body> body;
-    node_ptr<AssignmentStatement> action;
-
-    ForLoop(node_ptr<VariableDeclaration> loop_var, node_ptr<Expression> cond, node_ptr<Body> body, node_ptr<AssignmentStatement> action) {
+    Symbol loop_var;
+    node_ptr<Expression> from = nullptr;
+    node_ptr<Expression> to = nullptr;
+    bool reverse = false;
+    node_ptr<Body> body = nullptr;
+    size_t offset = 0; // of the for keyword in the source
+
+    ForLoop(Symbol loop_var, node_ptr<Expression> from, node_ptr<Expression> to, bool reverse, node_ptr<Body> body, size_t offset = 0) {
         this->loop_var = loop_var;
-        this->cond = cond;
+        this->from = from;
+        this->to = to;
+        this->reverse = reverse;
         this->body = body;
-        this->action = action;
+        this->offset = offset;
     }
 
     void accept(Visitor *v) override { v->visit(this); }
 };
 
 struct RoutineCall : Statement, Expression {
-    node_ptr<RoutineDeclaration> routine;
+    Symbol name;
+    node_ptr<RoutineDeclaration> routine = nullptr; // resolved by the parser, possibly after the call
     std::vector<node_ptr<Expression>> args;
 
-    RoutineCall(node_ptr<RoutineDeclaration> routine, std::vector<node_ptr<Expression>> args) {
-        this->routine = routine;
-        this->args = args;
+    RoutineCall(Symbol name, std::vector<node_ptr<Expression>> args) {
+        this->name = name;
+        this->args = std::move(args);
     }
 
     void accept(Visitor *v) override { v->visit(this); }
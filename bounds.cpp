@@ -0,0 +1,243 @@
+#include "bounds.hpp"
+
+// Whether a body (or a nested one) assigns to sym.
+static bool assigns(ast::Body *body, ast::Symbol sym) {
+    if (!body) {
+        return false;
+    }
+    for (auto& stmt : body->statements) {
+        if (auto assignment = dynamic_cast<ast::AssignmentStatement*>(stmt)) {
+            if (assignment->id->name == sym) {
+                return true;
+            }
+        }
+        else if (auto if_stmt = dynamic_cast<ast::IfStatement*>(stmt)) {
+            if (assigns(if_stmt->then_body, sym) || assigns(if_stmt->else_body, sym)) {
+                return true;
+            }
+        }
+        else if (auto while_loop = dynamic_cast<ast::WhileLoop*>(stmt)) {
+            if (assigns(while_loop->body, sym)) {
+                return true;
+            }
+        }
+        else if (auto for_loop = dynamic_cast<ast::ForLoop*>(stmt)) {
+            if (assigns(for_loop->body, sym)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void BoundsCheckEliminator::declare(ast::Symbol sym, Known k) {
+    auto it = known.find(sym);
+    saved.emplace_back(sym, it == known.end() ? std::nullopt : std::optional<Known>(it->second));
+    known[sym] = k;
+}
+
+// Record fields are variables named "<record>.<field>".
+void BoundsCheckEliminator::declare_fields(ast::RecordType *rt, const std::string &prefix) {
+    for (auto& field : rt->fields) {
+        std::string name = prefix + "." + program.symbols.name(field->name);
+        ast::Symbol sym = program.symbols.find(name);
+        if (!field->dtype) {
+            continue;
+        }
+        if (field->dtype->getType() == ast::TypeEnum::RECORD) {
+            declare_fields(static_cast<ast::RecordType*>(field->dtype), name);
+        }
+        else if (sym != ast::NO_SYMBOL) {
+            Known k;
+            if (field->dtype->getType() == ast::TypeEnum::ARRAY) {
+                if (auto size = dynamic_cast<ast::IntLiteral*>(static_cast<ast::ArrayType*>(field->dtype)->size)) {
+                    k.size = size->value;
+                }
+            }
+            declare(sym, k);
+        }
+    }
+}
+
+void BoundsCheckEliminator::pop(size_t mark) {
+    while (saved.size() > mark) {
+        if (saved.back().second) {
+            known[saved.back().first] = *saved.back().second;
+        }
+        else {
+            known.erase(saved.back().first);
+        }
+        saved.pop_back();
+    }
+}
+
+// Whether an index expression is known to lie within 1..size.
+bool BoundsCheckEliminator::fits(ast::Expression *idx, int64_t size) {
+    if (auto literal = dynamic_cast<ast::IntLiteral*>(idx)) {
+        return literal->value >= 1 && literal->value <= size;
+    }
+    auto id = dynamic_cast<ast::Identifier*>(idx);
+    if (!id || id->idx) {
+        return false;
+    }
+    auto it = known.find(id->name);
+    if (it == known.end() || !it->second.is_counter) {
+        return false;
+    }
+    return it->second.lo > it->second.hi || (it->second.lo >= 1 && it->second.hi <= size);
+}
+
+void BoundsCheckEliminator::visit(ast::Program *program) {
+    for (auto& var : program->variables) {
+        var->accept(this);
+    }
+    for (auto& routine : program->routines) {
+        routine->accept(this);
+    }
+}
+
+void BoundsCheckEliminator::visit(ast::IntType *it) {}
+void BoundsCheckEliminator::visit(ast::RealType *rt) {}
+void BoundsCheckEliminator::visit(ast::BoolType *bt) {}
+
+void BoundsCheckEliminator::visit(ast::ArrayType *at) {
+    at->size->accept(this);
+}
+
+void BoundsCheckEliminator::visit(ast::RecordType *rt) {
+    for (auto& field : rt->fields) {
+        if (field->dtype) {
+            field->dtype->accept(this);
+        }
+        if (field->initial_value) {
+            field->initial_value->accept(this);
+        }
+    }
+}
+
+void BoundsCheckEliminator::visit(ast::IntLiteral *il) {}
+void BoundsCheckEliminator::visit(ast::RealLiteral *rl) {}
+void BoundsCheckEliminator::visit(ast::BoolLiteral *bl) {}
+
+void BoundsCheckEliminator::visit(ast::VariableDeclaration *var) {
+    if (var->dtype) {
+        var->dtype->accept(this);
+    }
+    if (var->initial_value) {
+        var->initial_value->accept(this);
+    }
+
+    Known k;
+    if (var->dtype && var->dtype->getType() == ast::TypeEnum::ARRAY) {
+        if (auto size = dynamic_cast<ast::IntLiteral*>(static_cast<ast::ArrayType*>(var->dtype)->size)) {
+            k.size = size->value;
+        }
+    }
+    else if (var->dtype && var->dtype->getType() == ast::TypeEnum::RECORD) {
+        declare_fields(static_cast<ast::RecordType*>(var->dtype), program.symbols.name(var->name));
+    }
+    declare(var->name, k);
+}
+
+void BoundsCheckEliminator::visit(ast::Identifier *id) {
+    if (!id->idx) {
+        return;
+    }
+    id->idx->accept(this);
+
+    auto it = known.find(id->name);
+    if (it != known.end() && it->second.size >= 0 && fits(id->idx, it->second.size)) {
+        id->check_bounds = false;
+    }
+}
+
+void BoundsCheckEliminator::visit(ast::Cast *cast) {
+    cast->operand->accept(this);
+}
+
+void BoundsCheckEliminator::visit(ast::UnaryExpression *exp) {
+    exp->operand->accept(this);
+}
+
+void BoundsCheckEliminator::visit(ast::BinaryExpression *exp) {
+    exp->lhs->accept(this);
+    exp->rhs->accept(this);
+}
+
+void BoundsCheckEliminator::visit(ast::RoutineDeclaration *routine) {
+    size_t mark = saved.size();
+    for (auto& param : routine->params) {
+        declare(param->name, Known{});
+    }
+    if (routine->body) {
+        routine->body->accept(this);
+    }
+    pop(mark);
+}
+
+void BoundsCheckEliminator::visit(ast::Body *body) {
+    size_t mark = saved.size();
+    for (auto& var : body->variables) {
+        var->accept(this);
+    }
+    for (auto& stmt : body->statements) {
+        stmt->accept(this);
+    }
+    pop(mark);
+}
+
+void BoundsCheckEliminator::visit(ast::ReturnStatement *stmt) {
+    if (stmt->exp) {
+        stmt->exp->accept(this);
+    }
+}
+
+void BoundsCheckEliminator::visit(ast::PrintStatement *stmt) {
+    if (stmt->exp) {
+        stmt->exp->accept(this);
+    }
+}
+
+void BoundsCheckEliminator::visit(ast::AssignmentStatement *stmt) {
+    stmt->id->accept(this);
+    stmt->exp->accept(this);
+}
+
+void BoundsCheckEliminator::visit(ast::IfStatement *stmt) {
+    stmt->cond->accept(this);
+    stmt->then_body->accept(this);
+    if (stmt->else_body) {
+        stmt->else_body->accept(this);
+    }
+}
+
+void BoundsCheckEliminator::visit(ast::WhileLoop *stmt) {
+    stmt->cond->accept(this);
+    stmt->body->accept(this);
+}
+
+// The counter only takes values from..to (in either direction), unless the body assigns to it.
+void BoundsCheckEliminator::visit(ast::ForLoop *stmt) {
+    stmt->from->accept(this);
+    stmt->to->accept(this);
+
+    Known k;
+    auto from = dynamic_cast<ast::IntLiteral*>(stmt->from);
+    auto to = dynamic_cast<ast::IntLiteral*>(stmt->to);
+    if (from && to && !assigns(stmt->body, stmt->loop_var)) {
+        k.is_counter = true;
+        k.lo = from->value; // a reverse loop runs from "to" down to "from"
+        k.hi = to->value;
+    }
+
+    size_t mark = saved.size();
+    declare(stmt->loop_var, k);
+    stmt->body->accept(this);
+    pop(mark);
+}
+
+void BoundsCheckEliminator::visit(ast::RoutineCall *stmt) {
+    for (auto& arg : stmt->args) {
+        arg->accept(this);
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ast.hpp"
+
+// Clears Identifier::check_bounds on array accesses that cannot go out of bounds, so
+// --bounds-check costs nothing on them: constant indices within the array, and the counter of an
+// enclosing for loop whose (constant) range lies within the array and that the body never assigns.
+// Runs after ConstantFolder, so sizes and ranges that are constant expressions are literals.
+class BoundsCheckEliminator : public Visitor {
+public:
+    BoundsCheckEliminator(ast::Program &program) : program(program) {}
+
+    void visit(ast::Program *program) override;
+    void visit(ast::IntType *it) override;
+    void visit(ast::RealType *rt) override;
+    void visit(ast::BoolType *bt) override;
+    void visit(ast::ArrayType *at) override;
+    void visit(ast::RecordType *rt) override;
+    void visit(ast::IntLiteral *il) override;
+    void visit(ast::RealLiteral *rl) override;
+    void visit(ast::BoolLiteral *bl) override;
+    void visit(ast::VariableDeclaration *var) override;
+    void visit(ast::Identifier *id) override;
+    void visit(ast::Cast *cast) override;
+    void visit(ast::UnaryExpression *exp) override;
+    void visit(ast::BinaryExpression *exp) override;
+    void visit(ast::RoutineDeclaration *routine) override;
+    void visit(ast::Body *body) override;
+    void visit(ast::ReturnStatement *stmt) override;
+    void visit(ast::PrintStatement *stmt) override;
+    void visit(ast::AssignmentStatement *stmt) override;
+    void visit(ast::IfStatement *stmt) override;
+    void visit(ast::WhileLoop *stmt) override;
+    void visit(ast::ForLoop *stmt) override;
+    void visit(ast::RoutineCall *stmt) override;
+
+private:
+    // What is known about the innermost variable of a name
+    struct Known {
+        int64_t size = -1;         // arrays of constant size
+        int64_t lo = 1, hi = 0;    // for loop counters: every value taken (empty if lo > hi)
+        bool is_counter = false;
+    };
+
+    ast::Program &program;
+    std::unordered_map<ast::Symbol, Known> known;
+    std::vector<std::pair<ast::Symbol, std::optional<Known>>> saved; // what each declaration hid, innermost last
+
+    void declare(ast::Symbol sym, Known k);
+    void declare_fields(ast::RecordType *rt, const std::string &prefix);
+    void pop(size_t mark);
+    bool fits(ast::Expression *idx, int64_t size);
+};
+
+#endif // BOUNDS_H
@@ -1,4 +1,4 @@
 mkdir -p build
 cmake -S . -B build
 cmake --build build
-cp build/cplus tests
\ No newline at end of file
+cp build/cplus build/libcplus_rt.a tests
\ No newline at end of file
@@ -0,0 +1,134 @@
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/SHA1.h>
+
+#include "cache.hpp"
+#include "llvm.hpp"
+#include "shell.hpp"
+
+namespace cplus {
+
+// Hash of a file's contents, or of nothing if it cannot be read.
+static std::string file_hash(const std::string &path) {
+    llvm::SHA1 sha;
+    if (auto file = llvm::MemoryBuffer::getFile(path)) {
+        sha.update((*file)->getBuffer());
+    }
+    return llvm::toHex(sha.final(), true);
+}
+
+// Identity of the compiler build: the executable itself, so that rebuilding any part of it
+// invalidates the cache. Hashed once per process (the compile server's jobs inherit it).
+static const std::string &compiler_hash() {
+    static int anchor;
+    static const std::string hash = file_hash(llvm::sys::fs::getMainExecutable("cplus", &anchor));
+    return hash;
+}
+
+void Cache::warm_up() {
+    compiler_hash();
+}
+
+// Hashes the source buffer, the compiler and runtime builds and the options.
+Cache::Cache(Shell &shell) {
+    if (const char *env = std::getenv("CPLUS_CACHE_DIR")) {
+        dir = env;
+    }
+    else {
+        llvm::SmallString<128> path;
+        if (llvm::sys::path::cache_directory(path)) {
+            llvm::sys::path::append(path, "cplus");
+            dir = path.str().str();
+        }
+    }
+
+    llvm::StringRef text = shell.source->getBuffer();
+
+    llvm::SHA1 sha;
+    sha.update(std::to_string(text.size()) + "\n");
+    sha.update(text);
+    sha.update("\ncompiler=" + compiler_hash() + " llvm-" LLVM_VERSION_STRING);
+    sha.update("\nruntime=" + file_hash(IRGenerator::runtime_library()));
+    sha.update("\ntriple=" + llvm::sys::getDefaultTargetTriple());
+    std::string options = "-O" + std::to_string(shell.opt_level) + " -mcpu=" + shell.cpu + " -mattr=" + shell.features;
+    if (shell.line_buffered) {
+        options += " --line-buffered";
+    }
+    if (shell.bounds_check) {
+        options += " --bounds-check";
+    }
+    if (shell.always_inline) {
+        options += " --always-inline";
+    }
+    if (shell.inline_threshold >= 0) {
+        options += " --inline-threshold=" + std::to_string(shell.inline_threshold);
+    }
+    if (!shell.profile_generate.empty()) {
+        options += " --profile-generate=" + shell.profile_generate;
+    }
+    if (shell.emit != Emit::EXECUTABLE) { // the same source may be cached as an executable and an object
+        options += " --emit=" + std::to_string(static_cast<int>(shell.emit));
+    }
+    sha.update("\noptions=" + options);
+    if (!shell.profile_use.empty()) { // the profile itself, as it changes under the same name
+        if (auto profile = llvm::MemoryBuffer::getFile(shell.profile_use)) {
+            sha.update("\nprofile=");
+            sha.update((*profile)->getBuffer());
+        }
+    }
+
+    llvm::SmallString<128> path(dir);
+    llvm::sys::path::append(path, llvm::toHex(sha.final(), true));
+    entry = path.str().str();
+}
+
+// Copies the cached output to outfile. Returns true on a hit. A hard link would let a later
+// write to outfile (a recompile in place, strip) change the entry under its old key.
+bool Cache::fetch(const std::string &outfile) {
+    if (dir.empty() || !llvm::sys::fs::exists(entry)) {
+        return false;
+    }
+
+    llvm::sys::fs::remove(outfile);
+    if (llvm::sys::fs::copy_file(entry, outfile)) {
+        return false;
+    }
+
+    auto perms = llvm::sys::fs::getPermissions(entry);
+    if (perms) {
+        llvm::sys::fs::setPermissions(outfile, *perms);
+    }
+    return true;
+}
+
+// Copies a freshly linked executable into the cache. Failures only cost a future hit.
+void Cache::store(const std::string &outfile) {
+    if (dir.empty() || llvm::sys::fs::create_directories(dir)) {
+        return;
+    }
+
+    // Write under a unique name and rename, so concurrent compiles never see a partial entry.
+    llvm::SmallString<128> tmp;
+    if (llvm::sys::fs::createUniqueFile(entry + ".%%%%%%", tmp)) {
+        return;
+    }
+    if (llvm::sys::fs::copy_file(outfile, tmp)) {
+        llvm::sys::fs::remove(tmp);
+        return;
+    }
+
+    auto perms = llvm::sys::fs::getPermissions(outfile);
+    if (perms) {
+        llvm::sys::fs::setPermissions(tmp, *perms);
+    }
+    if (llvm::sys::fs::rename(tmp, entry)) {
+        llvm::sys::fs::remove(tmp);
+    }
+}
+
+} // namespace cplus
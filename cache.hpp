@@ -0,0 +1,25 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <string>
+
+namespace cplus {
+class Shell;
+
+// Content-addressed store of linked executables. An entry is keyed by a hash of the source
+// bytes, the compiler and runtime library builds, the target triple and the codegen options.
+class Cache {
+public:
+    Cache(Shell &shell);
+    static void warm_up(); // hashes the compiler ahead of forked compiles
+
+    bool fetch(const std::string &outfile);
+    void store(const std::string &outfile);
+
+private:
+    std::string dir;
+    std::string entry;
+};
+} // namespace cplus
+
+#endif // CACHE_H
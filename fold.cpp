@@ -0,0 +1,404 @@
+#include <cmath>
+
+#include "fold.hpp"
+
+using ast::TypeEnum;
+
+static bool is_primitive(ast::Type *type) {
+    return type && (type->getType() == TypeEnum::INT || type->getType() == TypeEnum::REAL || type->getType() == TypeEnum::BOOL);
+}
+
+void ConstantFolder::visit(ast::Program *program) {
+    // A global is only a constant if no routine ever assigns to it.
+    for (auto& routine : program->routines) {
+        collect_assigned(routine->body);
+    }
+
+    for (auto& var : program->variables) {
+        var->accept(this);
+    }
+    global_vars_pass = false;
+
+    for (auto& routine : program->routines) {
+        routine->accept(this);
+    }
+}
+
+void ConstantFolder::collect_assigned(ast::Body *body) {
+    if (!body) {
+        return;
+    }
+    for (auto& stmt : body->statements) {
+        if (auto assignment = dynamic_cast<ast::AssignmentStatement*>(stmt)) {
+            assigned.insert(assignment->id->name);
+        }
+        else if (auto if_stmt = dynamic_cast<ast::IfStatement*>(stmt)) {
+            collect_assigned(if_stmt->then_body);
+            collect_assigned(if_stmt->else_body);
+        }
+        else if (auto while_loop = dynamic_cast<ast::WhileLoop*>(stmt)) {
+            collect_assigned(while_loop->body);
+        }
+        else if (auto for_loop = dynamic_cast<ast::ForLoop*>(stmt)) {
+            collect_assigned(for_loop->body);
+        }
+    }
+}
+
+// Visits an expression and replaces it with a literal if it turned out to be constant.
+void ConstantFolder::fold(ast::node_ptr<ast::Expression> &exp) {
+    exp->accept(this);
+    bool is_literal = dynamic_cast<ast::IntLiteral*>(exp) || dynamic_cast<ast::RealLiteral*>(exp) || dynamic_cast<ast::BoolLiteral*>(exp);
+    if (value && !is_literal) {
+        exp = literal(*value);
+    }
+}
+
+ast::node_ptr<ast::Expression> ConstantFolder::literal(const Constant &c) {
+    switch (c.type) {
+        case TypeEnum::INT:  return program.arena.make<ast::IntLiteral>(c.i);
+        case TypeEnum::REAL: return program.arena.make<ast::RealLiteral>(c.r);
+        default:             return program.arena.make<ast::BoolLiteral>(c.i != 0);
+    }
+}
+
+// Conversion as IRGenerator::cast_primitive performs it.
+// Conversions whose result codegen leaves undefined are not folded.
+std::optional<ConstantFolder::Constant> ConstantFolder::convert(const Constant &c, TypeEnum type) {
+    if (c.type == type) {
+        return c;
+    }
+    Constant out{type};
+    if (c.type == TypeEnum::INT && type == TypeEnum::REAL) {
+        out.r = static_cast<double>(c.i);
+    }
+    else if (c.type == TypeEnum::INT && type == TypeEnum::BOOL) {
+        out.i = c.i != 0;
+    }
+    else if (c.type == TypeEnum::BOOL && type == TypeEnum::INT) {
+        out.i = c.i;
+    }
+    else if (c.type == TypeEnum::BOOL && type == TypeEnum::REAL) {
+        out.r = static_cast<double>(c.i);
+    }
+    else if (c.type == TypeEnum::REAL && type == TypeEnum::BOOL) {
+        out.i = c.r != 0.0; // NaN is true
+    }
+    else if (c.type == TypeEnum::REAL && type == TypeEnum::INT) {
+        if (!(c.r >= -9223372036854775808.0 && c.r < 9223372036854775808.0)) { // also rejects NaN
+            return std::nullopt;
+        }
+        out.i = static_cast<int64_t>(c.r);
+    }
+    else {
+        return std::nullopt;
+    }
+    return out;
+}
+
+void ConstantFolder::declare_local(ast::Symbol sym) {
+    locals.push_back(sym);
+    shadowed[sym]++;
+}
+
+void ConstantFolder::pop_locals(size_t mark) {
+    while (locals.size() > mark) {
+        if (--shadowed[locals.back()] == 0) {
+            shadowed.erase(locals.back());
+        }
+        locals.pop_back();
+    }
+}
+
+void ConstantFolder::visit(ast::IntType *it) {}
+void ConstantFolder::visit(ast::RealType *rt) {}
+void ConstantFolder::visit(ast::BoolType *bt) {}
+
+void ConstantFolder::visit(ast::ArrayType *at) {
+    fold(at->size);
+    value.reset();
+}
+
+void ConstantFolder::visit(ast::RecordType *rt) {
+    for (auto& field : rt->fields) {
+        fold_declaration(field);
+    }
+    value.reset();
+}
+
+void ConstantFolder::visit(ast::IntLiteral *il) {
+    value = Constant{TypeEnum::INT, il->value};
+}
+
+void ConstantFolder::visit(ast::RealLiteral *rl) {
+    value = Constant{TypeEnum::REAL, 0, rl->value};
+}
+
+void ConstantFolder::visit(ast::BoolLiteral *bl) {
+    value = Constant{TypeEnum::BOOL, bl->value};
+}
+
+// Folds the size of an array type and the initializer of a declaration.
+// Leaves the initializer's value (if constant) in value.
+void ConstantFolder::fold_declaration(ast::VariableDeclaration *var) {
+    var->dtype->accept(this);
+    value.reset();
+
+    if (var->initial_value) {
+        fold(var->initial_value);
+    }
+}
+
+void ConstantFolder::visit(ast::VariableDeclaration *var) {
+    fold_declaration(var);
+
+    if (!global_vars_pass) {
+        declare_local(var->name); // after the initializer, which still sees an outer variable
+    }
+    else if (!assigned.count(var->name)) {
+        if (value) {
+            globals[var->name] = *value;
+        }
+        else if (!var->initial_value && is_primitive(var->dtype)) {
+            globals[var->name] = Constant{var->dtype->getType()}; // globals start zeroed
+        }
+    }
+    value.reset();
+}
+
+void ConstantFolder::visit(ast::Identifier *id) {
+    value.reset();
+
+    if (id->idx) {
+        fold(id->idx);
+        value.reset();
+        return;
+    }
+
+    if (shadowed.count(id->name)) {
+        return;
+    }
+    auto it = globals.find(id->name);
+    if (it != globals.end()) {
+        value = it->second;
+    }
+}
+
+void ConstantFolder::visit(ast::Cast *cast) {
+    fold(cast->operand);
+    if (value) {
+        value = convert(*value, cast->dtype->getType());
+    }
+}
+
+void ConstantFolder::visit(ast::UnaryExpression *exp) {
+    fold(exp->operand);
+    if (!value) {
+        return;
+    }
+
+    Constant c = *value;
+    value.reset();
+    switch (exp->op) {
+        case ast::OperatorEnum::MINUS:
+            if (c.type == TypeEnum::INT) {
+                value = Constant{TypeEnum::INT, static_cast<int64_t>(0 - static_cast<uint64_t>(c.i))};
+            }
+            else if (c.type == TypeEnum::REAL) {
+                value = Constant{TypeEnum::REAL, 0, -c.r};
+            }
+            break;
+
+        case ast::OperatorEnum::NOT:
+            if (c.type == TypeEnum::BOOL) {
+                value = Constant{TypeEnum::BOOL, !c.i};
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+void ConstantFolder::visit(ast::BinaryExpression *exp) {
+    fold(exp->lhs);
+    auto L = value;
+    fold(exp->rhs);
+    auto R = value;
+    value.reset();
+    if (!L || !R) {
+        return;
+    }
+
+    // Both operands have the same type
+    bool ints = L->type == TypeEnum::INT;
+    bool bools = L->type == TypeEnum::BOOL;
+    bool reals = L->type == TypeEnum::REAL;
+    double l = L->r, r = R->r;
+    uint64_t a = L->i, b = R->i;
+
+    auto int_result = [&](uint64_t i) { value = Constant{TypeEnum::INT, static_cast<int64_t>(i)}; };
+    auto real_result = [&](double d) { value = Constant{TypeEnum::REAL, 0, d}; };
+    auto bool_result = [&](bool v) { value = Constant{TypeEnum::BOOL, v}; };
+    bool unordered = std::isnan(l) || std::isnan(r);
+
+    switch (exp->op) {
+        case ast::OperatorEnum::PLUS:
+            if (ints) int_result(a + b);
+            else if (reals) real_result(l + r);
+            break;
+
+        case ast::OperatorEnum::MINUS:
+            if (ints) int_result(a - b);
+            else if (reals) real_result(l - r);
+            break;
+
+        case ast::OperatorEnum::MUL:
+            if (ints) int_result(a * b);
+            else if (reals) real_result(l * r);
+            break;
+
+        case ast::OperatorEnum::DIV:
+        case ast::OperatorEnum::MOD:
+            if (ints) {
+                // Division by zero and INT64_MIN / -1 are undefined; leave them to run time.
+                if (R->i == 0 || (L->i == INT64_MIN && R->i == -1)) {
+                    break;
+                }
+                int_result(exp->op == ast::OperatorEnum::DIV ? L->i / R->i : L->i % R->i);
+            }
+            else if (reals && exp->op == ast::OperatorEnum::DIV) {
+                real_result(l / r);
+            }
+            break;
+
+        case ast::OperatorEnum::AND:
+            if (bools) bool_result(L->i && R->i);
+            else if (ints) int_result(a & b);
+            break;
+
+        case ast::OperatorEnum::OR:
+            if (bools) bool_result(L->i || R->i);
+            else if (ints) int_result(a | b);
+            break;
+
+        case ast::OperatorEnum::XOR:
+            if (bools) bool_result(L->i != R->i);
+            else if (ints) int_result(a ^ b);
+            break;
+
+        // Real comparisons are unordered (true if either side is NaN), as in codegen.
+        case ast::OperatorEnum::EQ:
+            if (ints || bools) bool_result(L->i == R->i);
+            else if (reals) bool_result(unordered || l == r);
+            break;
+
+        case ast::OperatorEnum::NEQ:
+            if (ints || bools) bool_result(L->i != R->i);
+            else if (reals) bool_result(unordered || l != r);
+            break;
+
+        case ast::OperatorEnum::LT:
+            if (ints) bool_result(L->i < R->i);
+            else if (reals) bool_result(unordered || l < r);
+            break;
+
+        case ast::OperatorEnum::GT:
+            if (ints) bool_result(L->i > R->i);
+            else if (reals) bool_result(unordered || l > r);
+            break;
+
+        case ast::OperatorEnum::LEQ:
+            if (ints) bool_result(L->i <= R->i);
+            else if (reals) bool_result(unordered || l <= r);
+            break;
+
+        case ast::OperatorEnum::GEQ:
+            if (ints) bool_result(L->i >= R->i);
+            else if (reals) bool_result(unordered || l >= r);
+            break;
+
+        default:
+            break;
+    }
+}
+
+void ConstantFolder::visit(ast::RoutineDeclaration *routine) {
+    size_t mark = locals.size();
+    for (auto& param : routine->params) {
+        declare_local(param->name);
+    }
+    if (routine->body) {
+        routine->body->accept(this);
+    }
+    pop_locals(mark);
+}
+
+void ConstantFolder::visit(ast::Body *body) {
+    size_t mark = locals.size();
+
+    for (auto& var : body->variables) {
+        var->accept(this);
+    }
+    for (auto& stmt : body->statements) {
+        stmt->accept(this);
+    }
+
+    pop_locals(mark);
+}
+
+void ConstantFolder::visit(ast::ReturnStatement *stmt) {
+    if (!stmt->exp) {
+        return;
+    }
+    fold(stmt->exp);
+    value.reset();
+}
+
+void ConstantFolder::visit(ast::PrintStatement *stmt) {
+    if (stmt->exp) {
+        fold(stmt->exp);
+    }
+    value.reset();
+}
+
+void ConstantFolder::visit(ast::AssignmentStatement *stmt) {
+    if (stmt->id->idx) {
+        fold(stmt->id->idx);
+    }
+    fold(stmt->exp);
+    value.reset();
+}
+
+void ConstantFolder::visit(ast::IfStatement *stmt) {
+    fold(stmt->cond);
+    value.reset();
+    stmt->then_body->accept(this);
+    if (stmt->else_body) {
+        stmt->else_body->accept(this);
+    }
+}
+
+void ConstantFolder::visit(ast::WhileLoop *stmt) {
+    fold(stmt->cond);
+    value.reset();
+    stmt->body->accept(this);
+}
+
+void ConstantFolder::visit(ast::ForLoop *stmt) {
+    fold(stmt->from);
+    fold(stmt->to);
+    value.reset();
+
+    size_t mark = locals.size();
+    declare_local(stmt->loop_var);
+    stmt->body->accept(this);
+    pop_locals(mark);
+}
+
+void ConstantFolder::visit(ast::RoutineCall *stmt) {
+    for (auto& arg : stmt->args) {
+        fold(arg);
+    }
+    value.reset();
+}
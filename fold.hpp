@@ -0,0 +1,69 @@
+#ifndef FOLD_H
+#define FOLD_H
+
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ast.hpp"
+
+// Evaluates constant expressions before codegen and replaces them with literals: literal
+// arithmetic, comparisons, casts, and reads of globals that are never assigned. Array sizes and
+// global initializers may thus be constant expressions. Runs after SemanticAnalyzer, so operands
+// have the same type and every conversion is an ast::Cast.
+// Only folds what codegen would compute the same way; everything else is left untouched.
+class ConstantFolder : public Visitor {
+public:
+    ConstantFolder(ast::Program &program) : program(program) {}
+
+    void visit(ast::Program *program) override;
+    void visit(ast::IntType *it) override;
+    void visit(ast::RealType *rt) override;
+    void visit(ast::BoolType *bt) override;
+    void visit(ast::ArrayType *at) override;
+    void visit(ast::RecordType *rt) override;
+    void visit(ast::IntLiteral *il) override;
+    void visit(ast::RealLiteral *rl) override;
+    void visit(ast::BoolLiteral *bl) override;
+    void visit(ast::VariableDeclaration *var) override;
+    void visit(ast::Identifier *id) override;
+    void visit(ast::Cast *cast) override;
+    void visit(ast::UnaryExpression *exp) override;
+    void visit(ast::BinaryExpression *exp) override;
+    void visit(ast::RoutineDeclaration *routine) override;
+    void visit(ast::Body *body) override;
+    void visit(ast::ReturnStatement *stmt) override;
+    void visit(ast::PrintStatement *stmt) override;
+    void visit(ast::AssignmentStatement *stmt) override;
+    void visit(ast::IfStatement *stmt) override;
+    void visit(ast::WhileLoop *stmt) override;
+    void visit(ast::ForLoop *stmt) override;
+    void visit(ast::RoutineCall *stmt) override;
+
+private:
+    // Value of a constant expression
+    struct Constant {
+        ast::TypeEnum type;
+        int64_t i = 0;   // INT, and BOOL (0 or 1)
+        double r = 0.0;  // REAL
+    };
+
+    ast::Program &program;
+    std::optional<Constant> value;                          // of the last visited expression
+    std::unordered_map<ast::Symbol, Constant> globals;      // globals that are never assigned
+    std::unordered_set<ast::Symbol> assigned;               // every assignment target
+    std::unordered_map<ast::Symbol, int> shadowed;          // locals hiding a global of that name
+    std::vector<ast::Symbol> locals;                        // declared locals, innermost last
+    bool global_vars_pass = true;
+
+    void fold(ast::node_ptr<ast::Expression> &exp);
+    void fold_declaration(ast::VariableDeclaration *var);
+    ast::node_ptr<ast::Expression> literal(const Constant &c);
+    std::optional<Constant> convert(const Constant &c, ast::TypeEnum type);
+    void declare_local(ast::Symbol sym);
+    void pop_locals(size_t mark);
+    void collect_assigned(ast::Body *body);
+};
+
+#endif // FOLD_H
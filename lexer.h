@@ -12,7 +12,8 @@
 #define YY_DECL cplus::Parser::symbol_type cplus::Lexer::get_next_token()
 
 #include "parser.hpp"
-#include <fstream>
+#include <algorithm>
+#include <string_view>
 
 namespace cplus {
     class Shell; 
@@ -22,9 +23,32 @@ namespace cplus {
         Lexer(Shell& shell) : driver(shell) {}
         virtual ~Lexer() {}
         virtual cplus::Parser::symbol_type get_next_token();
-        
+
+        // Scans [begin, end), typically a memory-mapped source file that outlives the lexer.
+        void set_input(const char *begin, const char *end) {
+            input = next = begin;
+            input_end = end;
+            offset = 0;
+        }
+
+    protected:
+        // Feeds flex straight from the source buffer, bypassing iostreams.
+        int LexerInput(char *buf, int max_size) override {
+            size_t n = std::min(static_cast<size_t>(max_size), static_cast<size_t>(input_end - next));
+            std::copy(next, next + n, buf);
+            next += n;
+            return static_cast<int>(n);
+        }
+
     private:
         Shell &driver;
+        const char *input = nullptr, *next = nullptr, *input_end = nullptr;
+        size_t offset = 0; // end of the current token in input, advanced by YY_USER_ACTION
+
+        // Current token as a view into the source buffer (stable, unlike yytext).
+        std::string_view token() const {
+            return std::string_view(input + offset - yyleng, yyleng);
+        }
     };
 
 }
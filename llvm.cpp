@@ -1,4 +1,24 @@
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <sstream>
+
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/DiagnosticInfo.h>
+#include <llvm/IR/DiagnosticPrinter.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/IRReader/IRReader.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/MC/MCSubtargetInfo.h>
+#include <llvm/MC/SubtargetFeature.h>
+#include <llvm/Transforms/IPO/AlwaysInliner.h>
+#include <llvm/Transforms/IPO/Internalize.h>
+#include <llvm/Transforms/Scalar/InductiveRangeCheckElimination.h>
+#include <llvm/Support/Path.h>
+#include <llvm/Support/Process.h>
+
 #include "llvm.hpp"
+#include "runtime.h"
 
 #define RED         "\033[31m"
 #define CYAN        "\033[36m"
@@ -7,7 +27,7 @@
 
 #define GDEBUG(X)   if (shell.debug) std::cout << CYAN << X << RESET << std::endl;
 #define GWARNING(X) std::cerr << YELLOW << "[LLVM]: [WARNINGS]:\n" << X << RESET << std::endl;
-#define GERROR(X)   std::cerr << RED << "[LLVM]: [ERROR]: " << X << RESET << std::endl; std::exit(1);
+#define GERROR(X)   { std::ostringstream msg; msg << X; throw CodegenError(msg.str()); }
 
 #define BLOCK_B(X)                                           \
     if (shell.debug) {                                       \
@@ -29,31 +49,525 @@
         std::cout << "</" << X << ">" << RESET << std::endl; \
     }
 
-extern cplus::Shell shell;
+// Local arrays up to this many bytes (of constant size) live on the stack, larger ones on the heap.
+static const uint64_t MAX_STACK_ARRAY = 64 * 1024;
+
+// Collects what the loop vectorizer did with each loop of a module, for --vectorize-report.
+// Loops are identified by the "cplus.loop" entry of their llvm.loop metadata: their position in
+// IRGenerator::loops, plus one.
+class VectorizeReport : public llvm::DiagnosticHandler {
+public:
+    // Loop ID -> outcome, and how conclusive it is
+    std::map<unsigned, std::pair<int, std::string>> outcomes;
+
+    bool isAnalysisRemarkEnabled(llvm::StringRef pass) const override { return pass == "loop-vectorize"; }
+    bool isMissedOptRemarkEnabled(llvm::StringRef pass) const override { return pass == "loop-vectorize"; }
+    bool isPassedOptRemarkEnabled(llvm::StringRef pass) const override { return pass == "loop-vectorize" || pass == "loop-unroll"; }
+    bool isAnyRemarkEnabled() const override { return true; }
+
+    bool handleDiagnostics(const llvm::DiagnosticInfo &di) override {
+        auto remark = llvm::dyn_cast<llvm::DiagnosticInfoIROptimization>(&di);
+        if(!remark || !remark->isEnabled()) {
+            return false;
+        }
+        int rank;
+        if(llvm::isa<llvm::OptimizationRemark>(remark)) {
+            if(remark->getPassName() == llvm::StringRef("loop-unroll") && remark->getRemarkName() != "FullyUnrolled") {
+                return true;
+            }
+            rank = 3;
+        }
+        else if(llvm::isa<llvm::OptimizationRemarkMissed>(remark)) {
+            rank = 1;
+        }
+        else {
+            rank = 2; // an analysis: the reason a loop was not vectorized
+        }
+
+        auto header = llvm::dyn_cast_or_null<const llvm::BasicBlock>(remark->getCodeRegion());
+        unsigned loop = header ? loop_id(header) : 0;
+        if(loop) {
+            auto &outcome = outcomes[loop];
+            if(rank == 2 && outcome.first == 2) { // several reasons
+                outcome.second += "; " + remark->getMsg();
+            }
+            else if(rank >= outcome.first) {
+                outcome = {rank, remark->getMsg()};
+            }
+        }
+        return true;
+    }
+
+private:
+    static unsigned loop_id(const llvm::BasicBlock *header) {
+        for (auto pred : llvm::predecessors(header)) {
+            auto id = pred->getTerminator()->getMetadata(llvm::LLVMContext::MD_loop);
+            if(!id) {
+                continue;
+            }
+            for (auto& op : id->operands()) {
+                auto entry = llvm::dyn_cast_or_null<llvm::MDTuple>(op.get());
+                if(entry && entry->getNumOperands() == 2) {
+                    auto name = llvm::dyn_cast<llvm::MDString>(entry->getOperand(0));
+                    if(name && name->getString() == "cplus.loop") {
+                        return llvm::mdconst::extract<llvm::ConstantInt>(entry->getOperand(1))->getZExtValue();
+                    }
+                }
+            }
+        }
+        return 0;
+    }
+};
+
+// Pipelines of this thread by -O level, target CPU, target features, profile (generated or used) and link phase
+static thread_local std::map<std::tuple<int, std::string, std::string, std::string, std::string, llvm::ThinOrFullLTOPhase>, std::unique_ptr<Pipeline>> pipelines;
+static std::once_flag native_target;
+
+// Returns this thread's cached pipeline for the -O level, target and profile of options, creating it on first use.
+// Modules linked by link_bitcode only get the pre-link (simplification) part of the pipeline; the linked module
+// gets the link-time part, which inlines, unrolls and vectorizes once, across all of them.
+static Pipeline &get_pipeline(const cplus::Options &options, llvm::ThinOrFullLTOPhase phase = llvm::ThinOrFullLTOPhase::None) {
+    int opt_level = options.opt_level;
+    const std::string &cpu = options.cpu, &features = options.features;
+    auto &pipeline = pipelines[{opt_level, cpu, features, options.profile_generate, options.profile_use, phase}];
+    if(pipeline) {
+        return *pipeline;
+    }
+
+    std::call_once(native_target, [] {
+        llvm::InitializeNativeTarget();
+        llvm::InitializeNativeTargetAsmPrinter();
+    });
+
+    std::string triple = llvm::sys::getDefaultTargetTriple();
+    std::string err;
+    auto target = llvm::TargetRegistry::lookupTarget(triple, err);
+    if(!target) {
+        GERROR(err)
+    }
+
+    std::unique_ptr<llvm::MCSubtargetInfo> subtarget(target->createMCSubtargetInfo(triple, "", ""));
+    if(!subtarget->isCPUStringValid(cpu)) {
+        GERROR("Unknown CPU " << cpu << " for " << triple)
+    }
+
+    pipeline = std::make_unique<Pipeline>();
+
+    llvm::CodeGenOpt::Level codegen_level;
+    switch(opt_level) {
+        case 0:  codegen_level = llvm::CodeGenOpt::None; break;
+        case 1:  codegen_level = llvm::CodeGenOpt::Less; break;
+        case 2:  codegen_level = llvm::CodeGenOpt::Default; break;
+        default: codegen_level = llvm::CodeGenOpt::Aggressive; break;
+    }
+
+    llvm::TargetOptions target_options;
+    pipeline->target_machine.reset(target->createTargetMachine(triple, cpu, features, target_options, llvm::Reloc::PIC_, llvm::None, codegen_level));
+
+    // Loop and SLP vectorization from -O2 on, as clang does it
+    llvm::PipelineTuningOptions tuning;
+    tuning.LoopVectorization = opt_level >= 2;
+    tuning.SLPVectorization = opt_level >= 2;
+
+    // IR-level PGO: --profile-generate instruments every branch and routine entry (before inlining),
+    // --profile-use reads the counts back into branch weights and entry counts, which the inliner,
+    // block placement and the rest of the pipeline then consult.
+    // Linked modules were instrumented or annotated before linking, as in any LTO build.
+    llvm::Optional<llvm::PGOOptions> pgo;
+    bool linked = phase == llvm::ThinOrFullLTOPhase::FullLTOPostLink;
+    if(!options.profile_generate.empty() && !linked) {
+        pgo = llvm::PGOOptions(options.profile_generate, "", "", llvm::PGOOptions::IRInstr);
+    }
+    else if(!options.profile_use.empty() && !linked) {
+        pgo = llvm::PGOOptions(options.profile_use, "", "", llvm::PGOOptions::IRUse);
+    }
+
+    pipeline->pb = std::make_unique<llvm::PassBuilder>(pipeline->target_machine.get(), tuning, pgo);
+    pipeline->pb->registerModuleAnalyses(pipeline->mam);
+    pipeline->pb->registerCGSCCAnalyses(pipeline->cgam);
+    pipeline->pb->registerFunctionAnalyses(pipeline->fam);
+    pipeline->pb->registerLoopAnalyses(pipeline->lam);
+    pipeline->pb->crossRegisterProxies(pipeline->lam, pipeline->fam, pipeline->cgam, pipeline->mam);
+
+#if LLVM_VERSION_MAJOR >= 14
+    using OptimizationLevel = llvm::OptimizationLevel;
+#else
+    using OptimizationLevel = llvm::PassBuilder::OptimizationLevel;
+#endif
+    // Splits loops so that most iterations run without --bounds-check checks, when they
+    // index with the loop counter and could not be removed before codegen.
+    pipeline->pb->registerScalarOptimizerLateEPCallback([](llvm::FunctionPassManager &fpm, OptimizationLevel) {
+        fpm.addPass(llvm::IRCEPass());
+    });
+
+    // From -O1 on, the default pipeline is interprocedural: it inlines, propagates constants
+    // into routines (IPSCCP), removes dead arguments and optimizes globals. -O0 only inlines
+    // alwaysinline routines (and instruments or reads a profile, if asked to).
+    if(opt_level == 0) {
+        if(pgo) {
+            pipeline->mpm = pipeline->pb->buildO0DefaultPipeline(OptimizationLevel::O0, phase == llvm::ThinOrFullLTOPhase::FullLTOPreLink);
+        }
+        else {
+            pipeline->mpm.addPass(llvm::AlwaysInlinerPass(false));
+        }
+        return *pipeline;
+    }
+
+    OptimizationLevel level = opt_level == 1 ? OptimizationLevel::O1 : opt_level == 2 ? OptimizationLevel::O2 : OptimizationLevel::O3;
+    switch(phase) {
+        case llvm::ThinOrFullLTOPhase::FullLTOPreLink:
+            pipeline->mpm = pipeline->pb->buildLTOPreLinkDefaultPipeline(level);
+            break;
+        case llvm::ThinOrFullLTOPhase::FullLTOPostLink:
+            pipeline->mpm = pipeline->pb->buildLTODefaultPipeline(level, nullptr);
+            break;
+        default:
+            pipeline->mpm = pipeline->pb->buildPerModuleDefaultPipeline(level);
+            break;
+    }
+
+    return *pipeline;
+}
+
+// Initializes the calling thread's target machines and pass pipelines for every -O level ahead of time
+// (for the generic CPU; other targets are set up on first use).
+void IRGenerator::warm_up() {
+    cplus::Options options;
+    for (options.opt_level = 0; options.opt_level < 4; options.opt_level++) {
+        get_pipeline(options);
+    }
+}
 
 // Constructor
-IRGenerator::IRGenerator() {
-    module = std::make_unique<llvm::Module>(llvm::StringRef("ir.ll"), context);
-    builder = std::make_unique<llvm::IRBuilder<>>(context);
+IRGenerator::IRGenerator(cplus::Shell &shell, cplus::TimeReport &report, unsigned partition, unsigned partitions)
+    : shell(shell), report(report), partition(partition), partitions(partitions) {
+    context = std::make_unique<llvm::LLVMContext>();
+    module = std::make_unique<llvm::Module>(shell.infile, *context);
+    builder = std::make_unique<llvm::IRBuilder<>>(*context);
+
+    int_t = llvm::Type::getInt64Ty(*context);
+    real_t = llvm::Type::getDoubleTy(*context);
+    bool_t = llvm::Type::getInt1Ty(*context);
+
+    // Target machine for the host (or the -mcpu/-mattr target), used to emit object code in-process.
+    pipeline = &get_pipeline(shell, shell.link_module ? llvm::ThinOrFullLTOPhase::FullLTOPreLink : llvm::ThinOrFullLTOPhase::None);
+    target_machine = pipeline->target_machine.get();
+
+    module->setTargetTriple(target_machine->getTargetTriple().str());
+    module->setDataLayout(target_machine->createDataLayout());
+
+    if(shell.vectorize_report) {
+        auto handler = std::make_unique<VectorizeReport>();
+        vectorize_report = handler.get();
+        context->setDiagnosticHandler(std::move(handler));
+    }
+}
 
-    int_t = llvm::Type::getInt64Ty(context);
-    real_t = llvm::Type::getDoubleTy(context);
-    bool_t = llvm::Type::getInt1Ty(context);
+// Runs the new pass manager's default per-module pipeline for shell.opt_level
+void IRGenerator::optimize() {
+    pipeline->mpm.run(*module, pipeline->mam);
+
+    // Cached analyses refer to this module; drop them before the pipeline is reused.
+    pipeline->lam.clear();
+    pipeline->fam.clear();
+    pipeline->cgam.clear();
+    pipeline->mam.clear();
 }
 
-// Emits IR code as "ir.ll"
-void IRGenerator::generate() {
-    module->setTargetTriple(llvm::sys::getDefaultTargetTriple());
+// Prints, for every loop of the module, whether it was vectorized or why not
+void IRGenerator::print_vectorize_report() {
+    std::ostringstream out;
+    for (unsigned i = 0; i < loops.size(); i++) {
+        auto& [line, routine] = loops[i];
+        out << YELLOW << "[VECTORIZE]: " << shell.infile << ":" << line << ": in routine " << routine << ": ";
+        auto it = vectorize_report->outcomes.find(i + 1);
+        if(it != vectorize_report->outcomes.end()) {
+            out << it->second.second;
+        }
+        else if(shell.opt_level < 2) {
+            out << "loop not vectorized: vectorization runs at -O2 and above";
+        }
+        else {
+            out << "loop not vectorized: optimized away before vectorization";
+        }
+        out << RESET << '\n';
+    }
+    std::cerr << out.str();
+}
 
+// Verifies and optimizes the module (and writes it next to the source, foo.cp -> foo.ll, in debug mode)
+void IRGenerator::finalize() {
     std::string msg;
     llvm::raw_string_ostream out(msg);
-    if(llvm::verifyModule(*this->module, &out)) {
+    bool broken;
+    {
+        auto timer = report.time("verification");
+        broken = llvm::verifyModule(*this->module, &out);
+    }
+
+    if(broken) {
+        GERROR("Invalid IR:\n" << out.str())
+    }
+
+    {
+        auto timer = report.time("optimization");
+        optimize(); // only well-formed IR is handed to the pass pipeline
+    }
+
+    if(vectorize_report) {
+        print_vectorize_report();
+    }
+
+    if(shell.debug && shell.emit != cplus::Emit::IR) {
+        llvm::SmallString<128> path(shell.infile);
+        llvm::sys::path::replace_extension(path, ".ll");
+        std::error_code ec;
+        llvm::raw_fd_ostream irfile(path, ec, llvm::sys::fs::OF_Text);
+        if(!ec) {
+            module->print(irfile, nullptr);
+        }
+    }
+}
+
+// Writes the module to path as bitcode, textual IR, assembly or a native object file
+static int emit(llvm::Module &module, llvm::TargetMachine *target_machine, const std::string &path, cplus::Emit kind) {
+    bool text = kind == cplus::Emit::IR || kind == cplus::Emit::ASSEMBLY;
+    std::error_code ec;
+    llvm::raw_fd_ostream dest(path, ec, text ? llvm::sys::fs::OF_Text : llvm::sys::fs::OF_None);
+    if(ec) {
+        std::cerr << RED << "[LLVM]: [ERROR]: Cannot open " << path << ": " << ec.message() << RESET << std::endl;
+        return 1;
+    }
+
+    if(kind == cplus::Emit::BITCODE) {
+        llvm::WriteBitcodeToFile(module, dest);
+    }
+    else if(kind == cplus::Emit::IR) {
+        module.print(dest, nullptr);
+    }
+    else {
+        llvm::legacy::PassManager codegen;
+        auto type = kind == cplus::Emit::ASSEMBLY ? llvm::CGFT_AssemblyFile : llvm::CGFT_ObjectFile;
+        if(target_machine->addPassesToEmitFile(codegen, dest, nullptr, type)) {
+            std::cerr << RED << "[LLVM]: [ERROR]: Target cannot emit " << (text ? "assembly" : "object files") << RESET << std::endl;
+            return 1;
+        }
+        codegen.run(module);
+    }
+    dest.flush();
+
+    return 0;
+}
+
+// Emits the module in the form shell.emit asks for (an object file, when building an executable)
+int IRGenerator::generate(const std::string &path) {
+    finalize();
+
+    auto timer = report.time("emission");
+    auto kind = shell.emit == cplus::Emit::EXECUTABLE ? cplus::Emit::OBJECT : shell.emit;
+    return emit(*module, target_machine, path, kind);
+}
+
+// Prints what the IR linker reports; errors make link_bitcode fail.
+static void link_diagnostic(const llvm::DiagnosticInfo &info, void *failed) {
+    std::string msg;
+    llvm::raw_string_ostream out(msg);
+    llvm::DiagnosticPrinterRawOStream printer(out);
+    info.print(printer);
+
+    if(info.getSeverity() == llvm::DS_Error) {
+        *static_cast<bool*>(failed) = true;
+        std::cerr << RED << "[LLVM]: [ERROR]: " << out.str() << RESET << std::endl;
+    }
+    else if(info.getSeverity() == llvm::DS_Warning) {
         GWARNING(out.str())
     }
+}
+
+// Links LLVM modules (bitcode or textual IR) into one, optimizes it and emits it as an object file.
+// In a whole program (no objects are linked in besides the runtime) only main is called from
+// outside, so everything else becomes internal and the pipeline may inline, propagate constants
+// and drop routines across the modules.
+int IRGenerator::link_bitcode(const cplus::Options &options, cplus::TimeReport &report, const std::vector<std::string> &files,
+                              const std::string &objfile, bool whole_program) {
+    Pipeline &pipeline = get_pipeline(options, llvm::ThinOrFullLTOPhase::FullLTOPostLink);
+    bool failed = false;
+    llvm::LLVMContext context;
+    context.setDiagnosticHandlerCallBack(link_diagnostic, &failed);
+
+    llvm::Module module("cplus", context);
+    module.setTargetTriple(pipeline.target_machine->getTargetTriple().str());
+    module.setDataLayout(pipeline.target_machine->createDataLayout());
+    {
+        auto timer = report.time("module linking");
+        llvm::Linker linker(module);
+        for (auto& file : files) {
+            llvm::SMDiagnostic err;
+            auto part = llvm::parseIRFile(file, err, context);
+            if(!part) {
+                std::cerr << RED << "[LLVM]: [ERROR]: " << file << ":" << err.getLineNo() << ": " << err.getMessage().str() << RESET << std::endl;
+                return 1;
+            }
+            if(linker.linkInModule(std::move(part)) || failed) {
+                std::cerr << RED << "[LLVM]: [ERROR]: Cannot link " << file << RESET << std::endl;
+                return 1;
+            }
+        }
+    }
+
+    if(whole_program) {
+        llvm::internalizeModule(module, [](const llvm::GlobalValue &gv) { return gv.getName() == "main"; });
+    }
+
+    {
+        auto timer = report.time("optimization");
+        pipeline.mpm.run(module, pipeline.mam);
+        pipeline.lam.clear();
+        pipeline.fam.clear();
+        pipeline.cgam.clear();
+        pipeline.mam.clear();
+    }
+
+    auto timer = report.time("emission");
+    return emit(module, pipeline.target_machine.get(), objfile, cplus::Emit::OBJECT);
+}
+
+// JIT-compiles the module with ORC and calls its main, returning main's exit code
+int IRGenerator::run() {
+    finalize();
+
+    llvm::Function *main_fn = module->getFunction("main");
+    if(!main_fn) {
+        std::cerr << RED << "[LLVM]: [ERROR]: Routine main is not declared" << RESET << std::endl;
+        return 1;
+    }
+    llvm::Type *rtype = main_fn->getReturnType();
+
+    auto timer = std::make_unique<cplus::TimeReport::Scope>(report, "emission");
+
+    // Same target as the optimizer saw; the JIT's default is the host CPU with all its features.
+    llvm::orc::LLJITBuilder jit_builder;
+    if(shell.cpu != "generic" || !shell.features.empty()) {
+        llvm::orc::JITTargetMachineBuilder jtmb(target_machine->getTargetTriple());
+        jtmb.setCPU(shell.cpu);
+        jtmb.getFeatures() = llvm::SubtargetFeatures(shell.features);
+        jtmb.setCodeGenOptLevel(target_machine->getOptLevel());
+        jit_builder.setJITTargetMachineBuilder(std::move(jtmb));
+    }
+    auto jit = jit_builder.create();
+    if(!jit) {
+        std::cerr << RED << "[LLVM]: [ERROR]: " << llvm::toString(jit.takeError()) << RESET << std::endl;
+        return 1;
+    }
+
+    // printf and the rest of libc are resolved from the host process
+    auto host = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess((*jit)->getDataLayout().getGlobalPrefix());
+    if(!host) {
+        std::cerr << RED << "[LLVM]: [ERROR]: " << llvm::toString(host.takeError()) << RESET << std::endl;
+        return 1;
+    }
+    (*jit)->getMainJITDylib().addGenerator(std::move(*host));
+
+    // The runtime is linked into the compiler, so programs write to this process' buffer
+    llvm::orc::SymbolMap runtime;
+    auto define = [&](const char *name, void *addr) {
+        runtime[(*jit)->mangleAndIntern(name)] = llvm::JITEvaluatedSymbol(
+            llvm::pointerToJITTargetAddress(addr), llvm::JITSymbolFlags::Exported);
+    };
+    define("cplus_write_i64", reinterpret_cast<void*>(&cplus_write_i64));
+    define("cplus_write_f64", reinterpret_cast<void*>(&cplus_write_f64));
+    define("cplus_write_str", reinterpret_cast<void*>(&cplus_write_str));
+    define("cplus_bounds_error", reinterpret_cast<void*>(&cplus_bounds_error));
+    define("cplus_line_buffered", &cplus_line_buffered);
+    if(auto err = (*jit)->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(runtime)))) {
+        std::cerr << RED << "[LLVM]: [ERROR]: " << llvm::toString(std::move(err)) << RESET << std::endl;
+        return 1;
+    }
+
+    llvm::orc::ThreadSafeModule tsm(std::move(module), std::move(context));
+    if(auto err = (*jit)->addIRModule(std::move(tsm))) {
+        std::cerr << RED << "[LLVM]: [ERROR]: " << llvm::toString(std::move(err)) << RESET << std::endl;
+        return 1;
+    }
+
+    auto sym = (*jit)->lookup("main");
+    if(!sym) {
+        std::cerr << RED << "[LLVM]: [ERROR]: " << llvm::toString(sym.takeError()) << RESET << std::endl;
+        return 1;
+    }
+
+    timer.reset(); // JIT compilation happens in the lookup above
+
+    // main is called through its own signature; an integer or boolean result is the exit code.
+    // A boolean is only defined in the lowest bit of the returned register.
+    auto address = sym->getAddress();
+    int status = 0;
+    if(rtype->isIntegerTy(1)) {
+        status = reinterpret_cast<uint8_t (*)()>(address)() & 1;
+    }
+    else if(rtype->isIntegerTy()) {
+        status = static_cast<int>(reinterpret_cast<int64_t (*)()>(address)());
+    }
+    else if(rtype->isDoubleTy()) {
+        reinterpret_cast<double (*)()>(address)();
+    }
+    else {
+        reinterpret_cast<void (*)()>(address)();
+    }
+    cplus_flush();
+    return status;
+}
+
+// Links the object files into an executable using the system C compiler driver
+// $CPLUS_RUNTIME, else the libcplus_rt.a built with the compiler, else one installed next to it.
+std::string IRGenerator::runtime_library() {
+    if(auto path = llvm::sys::Process::GetEnv("CPLUS_RUNTIME")) {
+        return *path;
+    }
+    if(llvm::sys::fs::exists(CPLUS_RUNTIME_LIBRARY)) {
+        return CPLUS_RUNTIME_LIBRARY;
+    }
+    static int anchor;
+    llvm::SmallString<256> path(llvm::sys::path::parent_path(llvm::sys::fs::getMainExecutable("cplus", &anchor)));
+    llvm::sys::path::append(path, "libcplus_rt.a");
+    return std::string(path);
+}
+
+// Instrumented programs (--profile-generate) are linked by the clang of the LLVM the compiler is built
+// with, whose driver adds the profile runtime that writes this LLVM's .profraw format.
+int IRGenerator::link(cplus::TimeReport &report, const std::vector<std::string> &objfiles, const std::string &outfile, bool instrumented) {
+    auto timer = report.time("linking");
+
+    auto cc = instrumented ? llvm::sys::findProgramByName("clang", {CPLUS_LLVM_BINDIR}) : llvm::sys::findProgramByName("cc");
+    if(!cc && instrumented) {
+        std::cerr << RED << "[LLVM]: [ERROR]: --profile-generate links with clang from " CPLUS_LLVM_BINDIR ", which is not installed" << RESET << std::endl;
+        return 1;
+    }
+    if(!cc) {
+        std::cerr << RED << "[LLVM]: [ERROR]: No linker driver (cc) found in PATH" << RESET << std::endl;
+        return 1;
+    }
 
-    FILE *f = fopen("ir.ll", "w");
-    llvm::raw_fd_ostream outfile(fileno(f), true);
-    module->print(outfile, nullptr);
+    llvm::SmallVector<llvm::StringRef, 8> args = {*cc};
+    if(instrumented) {
+        args.push_back("-fprofile-generate");
+    }
+    args.append(objfiles.begin(), objfiles.end());
+    std::string runtime = runtime_library();
+    if(!llvm::sys::fs::exists(runtime)) {
+        std::cerr << RED << "[LLVM]: [ERROR]: Runtime library not found: " << runtime << RESET << std::endl;
+        return 1;
+    }
+    args.append({runtime, "-o", outfile});
+    std::string err;
+    if(llvm::sys::ExecuteAndWait(*cc, args, llvm::None, {}, 0, 0, &err)) {
+        if(!err.empty()) {
+            std::cerr << RED << "[LLVM]: [ERROR]: " << err << RESET << std::endl;
+        }
+        return 1;
+    }
+
+    return 0;
 }
 
 llvm::Value *IRGenerator::pop_v() {
@@ -62,19 +576,24 @@ llvm::Value *IRGenerator::pop_v() {
     return v;
 }
 
-llvm::Value *IRGenerator::pop_p() {
-    auto p = tmp_p;
-    tmp_p = nullptr;
-    return p;
-}
+// The LLVM type of a primitive type; nullptr for arrays and records, which have no value type.
+llvm::Type *IRGenerator::llvm_type(ast::Type *type) {
+    switch(type->getType()) {
+        case ast::TypeEnum::INT:
+            return int_t;
 
-llvm::Type *IRGenerator::pop_t() {
-    llvm::Type *t = tmp_t;
-    tmp_t = nullptr;
-    return t;
+        case ast::TypeEnum::REAL:
+            return real_t;
+
+        case ast::TypeEnum::BOOL:
+            return bool_t;
+
+        default:
+            return nullptr;
+    }
 }
 
-// handles primitive casting for AssignmentStatement and VariableDeclaration
+// Converts between primitive types, for ast::Cast
 llvm::Value *IRGenerator::cast_primitive(llvm::Value *value, llvm::Type *explicit_type, llvm::Type *implicit_type) {
     if(explicit_type == implicit_type) {
         return value;
@@ -83,125 +602,115 @@ llvm::Value *IRGenerator::cast_primitive(llvm::Value *value, llvm::Type *explici
         return builder->CreateFPToSI(value, explicit_type, "intcast");
     }
     else if(explicit_type == bool_t && implicit_type == real_t) { // real -> bool
-        return builder->CreateFPToSI(value, explicit_type, "boolcast");
+        return builder->CreateFCmpUNE(value, llvm::ConstantFP::get(real_t, 0.0), "boolcast");
     }
     else if(explicit_type == real_t && implicit_type == int_t) { // int -> real
         return builder->CreateSIToFP(value, explicit_type, "fpcast");
     }
     else if(explicit_type == bool_t && implicit_type == int_t) { // int -> bool
-        return builder->CreateICmpNE(value, llvm::ConstantInt::get(context, llvm::APInt(64, 0)), "boolcast");
+        return builder->CreateICmpNE(value, llvm::ConstantInt::get(*context, llvm::APInt(64, 0)), "boolcast");
     }
     else if(explicit_type == int_t && implicit_type == bool_t) { // bool -> int
         return builder->CreateIntCast(value, explicit_type, false);
     }
     else if(explicit_type == real_t && implicit_type == bool_t) { // bool -> real
-        return builder->CreateFPCast(value, explicit_type);
+        return builder->CreateUIToFP(value, explicit_type, "fpcast");
     }
-    std::cerr << RED << "[LLVM]: [ERROR]: Unsupported conversion: ";
-    explicit_type->print(llvm::errs());
-    std::cerr << " -> ";
-    implicit_type->print(llvm::errs());
-    std::cerr << std::endl;
-    std::exit(1);
+    std::string types;
+    llvm::raw_string_ostream out(types);
+    out << *explicit_type << " -> " << *implicit_type;
+    GERROR("Unsupported conversion: " << out.str())
 }
 
 void IRGenerator::visit(ast::Program *program) {
     BLOCK_B("Program")
 
-    std::reverse(program->variables.begin(), program->variables.end());
+    symbols = &program->symbols;
+    scopes.push();
 
     for (auto& u : program->variables) {
-
         u->accept(this);
     }
     
     global_vars_pass = false;
 
+    // Declare every routine first so calls may refer to routines defined later.
     for (auto& u : program->routines) {
-        u->accept(this);
-        is_first_routine = false;
+        declare_routine(u);
     }
 
+    for (size_t i = partition; i < program->routines.size(); i += partitions) {
+        if (program->routines[i]->body) {
+            program->routines[i]->accept(this);
+        }
+    }
+
+    scopes.pop();
+
     BLOCK_E("Program")
 }
 
-// Defines a global, or stores a pointer to the created local var in ptrs_table map.
+// Defines a global or a local var and binds a pointer to it in the current scope.
 void IRGenerator::visit(ast::VariableDeclaration *var) {
+    declare_variable(var, symbols->name(var->name), var->name);
+}
+
+// Declares var as name and binds it to sym, unless sym is ast::NO_SYMBOL (a record field
+// the program never refers to). The AST and symbol table are only read, as partitions share them.
+void IRGenerator::declare_variable(ast::VariableDeclaration *var, const std::string &name, ast::Symbol sym) {
     BLOCK_B("VariableDeclaration")
 
-    llvm::Type *dtype = nullptr;
     llvm::Value* initial_value = nullptr;
 
-    // var dtype is given
-    if (var->dtype) {
-
-        // dtype is an array
-        if (var->dtype->getType() == ast::TypeEnum::ARRAY) {
-            var->dtype->accept(this);         // array will be created by this visit,
-            ptrs_table[var->name] = pop_p();  // save a pointer to the array ptrs_table for later access.
-            BLOCK_E("VariableDeclaration")
-            return;
-        }
-
-        // dtype is a record
-        else if (var->dtype->getType() == ast::TypeEnum::RECORD) {
-            // downcasting node_ptr<Type> --> node_ptr<RecordType>
-            auto t = std::dynamic_pointer_cast<ast::RecordType>(var->dtype);
-            t->name = var->name;
-            t->accept(this);  // record fields will be created by this visit with "{var->name}." prefix.
-            BLOCK_E("VariableDeclaration")
-            return;
-        }
-
-        // dtype is primitive
-        else if (var->dtype->getType() == ast::TypeEnum::INT ||
-                 var->dtype->getType() == ast::TypeEnum::REAL ||
-                 var->dtype->getType() == ast::TypeEnum::BOOL) {
-            var->dtype->accept(this);
-            dtype = pop_t();
-
-            if(var->initial_value) {
-                var->initial_value->accept(this);
-                initial_value = pop_v();
-                initial_value = cast_primitive(initial_value, dtype, initial_value->getType());
-            }   
+    // dtype is an array
+    if (var->dtype->getType() == ast::TypeEnum::ARRAY) {
+        auto array = declare_array(static_cast<ast::ArrayType*>(var->dtype), name);
+        if (sym != ast::NO_SYMBOL) {
+            scopes.bind(sym, array);
         }
+        BLOCK_E("VariableDeclaration")
+        return;
+    }
 
-        // unknown dtype
-        else {
-            GERROR("Unsupported data type for variable" << var->name)
-        }
+    // dtype is a record
+    else if (var->dtype->getType() == ast::TypeEnum::RECORD) {
+        declare_record(static_cast<ast::RecordType*>(var->dtype), name);
+        BLOCK_E("VariableDeclaration")
+        return;
     }
 
-    // dtype is not given, deduce dtype from initial value
-    else {
+    // dtype is primitive (given, or deduced from the initializer by the semantic pass)
+    llvm::Type *dtype = llvm_type(var->dtype);
+    if(var->initial_value) {
         var->initial_value->accept(this);
         initial_value = pop_v();
-        dtype = pop_t();
-        
-        if(!dtype) {
-            GERROR("Cannot deduce variable dtype from initializer")
-        }
     }
     
     // Variable being declared is global
     if(global_vars_pass) {
 
         // Create the global
-        module->getOrInsertGlobal(var->name, dtype);
-        auto g = module->getNamedGlobal(var->name);
-        g->setLinkage(llvm::GlobalValue::ExternalLinkage);
+        module->getOrInsertGlobal(name, dtype);
+        auto g = module->getNamedGlobal(name);
+        g->setLinkage(linkage(name));
+        scopes.bind(sym, {g, dtype});
+
+        // Partition 0 defines the globals, the other partitions refer to them.
+        if(partition != 0) {
+            BLOCK_E("VariableDeclaration")
+            return;
+        }
 
         // global is not initialized, initialize it with default value
         if(!(initial_value)) {
             if(dtype == int_t) {
-                g->setInitializer(llvm::ConstantInt::get(context, llvm::APInt(64, 0, true)));
+                g->setInitializer(llvm::ConstantInt::get(*context, llvm::APInt(64, 0, true)));
             }
             else if(dtype == bool_t) {
-                g->setInitializer(llvm::ConstantInt::get(context, llvm::APInt(1, 0, false)));
+                g->setInitializer(llvm::ConstantInt::get(*context, llvm::APInt(1, 0, false)));
             }
             else if(dtype == real_t) {
-                g->setInitializer(llvm::ConstantFP::get(context, llvm::APFloat(0.0)));
+                g->setInitializer(llvm::ConstantFP::get(*context, llvm::APFloat(0.0)));
             }
             else {
                 GERROR("Global arrays/records are not supported")
@@ -236,7 +745,7 @@ void IRGenerator::visit(ast::VariableDeclaration *var) {
     // Variable being declared is local
     else {
         // Allocate space for the (primitive) variable
-        auto p = builder->CreateAlloca(dtype, nullptr, var->name);
+        auto p = create_entry_alloca(dtype, name);
 
         // If an initial value was given, store it in the allocated space. 
         if (initial_value) {
@@ -244,59 +753,110 @@ void IRGenerator::visit(ast::VariableDeclaration *var) {
         }
         
         // Save var location for later reference
-        ptrs_table[var->name] = p;
+        if (sym != ast::NO_SYMBOL) {
+            scopes.bind(sym, {p, dtype});
+        }
     }
 
     BLOCK_E("VariableDeclaration")
 }
 
-// Sets tmp_p and optionally tmp_v and tmp_t
-void IRGenerator::visit(ast::Identifier *id) {
-    BLOCK_B("Identifier")
+// Branches to a runtime error unless 0 <= offset < size. The error path is marked cold, which
+// also lets IRCE split loops over an array into a range that runs without checks.
+void IRGenerator::check_bounds(llvm::Value *idx, llvm::Value *offset, llvm::Value *size) {
+    auto in_bounds = builder->CreateICmpULT(offset, size, "inbounds");
+    if(auto known = llvm::dyn_cast<llvm::ConstantInt>(in_bounds); known && known->isOne()) {
+        return;
+    }
 
-    auto global = module->getNamedGlobal(id->name);
-    llvm::Value *p;
-    if(global) {
-        p = global;
+    llvm::Function *parent = builder->GetInsertBlock()->getParent();
+    auto ok_block = llvm::BasicBlock::Create(*context, "inbounds", parent);
+    auto error_block = llvm::BasicBlock::Create(*context, "outofbounds", parent);
+    llvm::MDBuilder weights(*context);
+    builder->CreateCondBr(in_bounds, ok_block, error_block, weights.createBranchWeights(1 << 20, 1));
+
+    builder->SetInsertPoint(error_block);
+    auto error_fn = module->getOrInsertFunction("cplus_bounds_error", llvm::Type::getVoidTy(*context), int_t, int_t);
+    if(auto f = llvm::dyn_cast<llvm::Function>(error_fn.getCallee())) {
+        f->setDoesNotReturn();
+        f->addFnAttr(llvm::Attribute::Cold);
     }
-    else if(args_table[id->name]) {
-        tmp_v = args_table[id->name];
-        BLOCK_E("Identifier")
-        return;
+    builder->CreateCall(error_fn, {idx, size});
+    builder->CreateUnreachable();
+
+    builder->SetInsertPoint(ok_block);
+}
+
+// Attaches llvm.loop metadata to the back edge of a loop: whether it is known to terminate, and
+// (with --vectorize-report) its ID, by which remarks about the loop are attributed to it.
+void IRGenerator::set_loop_metadata(llvm::Instruction *latch, size_t offset, bool finite) {
+    llvm::SmallVector<llvm::Metadata*, 3> ops = {nullptr}; // replaced by the self reference
+    if(finite) {
+        ops.push_back(llvm::MDNode::get(*context, llvm::MDString::get(*context, "llvm.loop.mustprogress")));
     }
-    else if(ptrs_table[id->name]) {
-        p = ptrs_table[id->name];
+    if(vectorize_report) {
+        loops.emplace_back(shell.line(offset), latch->getFunction()->getName().str());
+        ops.push_back(llvm::MDNode::get(*context, {
+            llvm::MDString::get(*context, "cplus.loop"),
+            llvm::ConstantAsMetadata::get(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context), loops.size()))
+        }));
     }
-    else {
-        GERROR(id->name << " is not declared.")
+    if(ops.size() == 1) {
+        return;
     }
-    
+    auto id = llvm::MDNode::getDistinct(*context, ops);
+    id->replaceOperandWith(0, id);
+    latch->setMetadata(llvm::LLVMContext::MD_loop, id);
+}
+
+// Returns the location an identifier designates (a variable, record field or array element)
+// and the type stored there. Emits no load, so assignment targets cost none.
+Variable IRGenerator::address(ast::Identifier *id) {
+    Variable var = scopes.lookup(id->name);
+    if(!var.p) {
+        GERROR(symbols->name(id->name) << " is not declared.")
+    }
+
     // Accessing an array element
     if(id->idx) {
+        llvm::Value *size = array_sizes.lookup(var.p);
+        if(!size) {
+            GERROR(symbols->name(id->name) << " is not an array")
+        }
         id->idx->accept(this);
+        auto idx = pop_v();
+
+        // Arrays are 1-indexed
+        auto offset = builder->CreateSub(idx, llvm::ConstantInt::get(int_t, 1), "offset");
+        if(shell.bounds_check && id->check_bounds) {
+            check_bounds(idx, offset, size);
+        }
 
         // GetElementPointer (GEP) instruction will get the array element location. 
-        tmp_p = builder->CreateGEP(p, pop_v());
+        return {builder->CreateGEP(var.dtype, var.p, offset), var.dtype};
     }
 
     // Accessing a primitive or a record field
-    else {
-        tmp_p = p;
-    }
+    return var;
+}
 
-    // If a value is stored there, load it, otherwise leave tmp_v and tmp_t as nullptrs.
-    // Other visits such as PrintStatement should handle unassigned values.
-    // TODO: remove this and handle loading in the appropriate places
-    auto val = builder->CreateLoad(tmp_p, id->name);
-    if(val) {
-        tmp_v = val;
-        tmp_t = tmp_v->getType();
-    }
+// Sets tmp_v: an identifier in an expression is read
+void IRGenerator::visit(ast::Identifier *id) {
+    BLOCK_B("Identifier")
+
+    Variable var = address(id);
+    tmp_v = builder->CreateLoad(var.dtype, var.p, symbols->name(id->name));
     
     BLOCK_E("Identifier")
 }
 
-// Sets tmp_v and tmp_t
+// Sets tmp_v
+void IRGenerator::visit(ast::Cast *cast) {
+    cast->operand->accept(this);
+    tmp_v = cast_primitive(pop_v(), llvm_type(cast->dtype), llvm_type(cast->operand->dtype));
+}
+
+// Sets tmp_v. The operand already has the type of the result.
 void IRGenerator::visit(ast::UnaryExpression *exp) {
     BLOCK_B("UnaryExpression")
     
@@ -305,26 +865,23 @@ void IRGenerator::visit(ast::UnaryExpression *exp) {
 
     switch (exp->op) {
         case ast::OperatorEnum::MINUS:
-            if(operand->getType()->isFloatingPointTy()) {
+            if(exp->dtype->getType() == ast::TypeEnum::REAL) {
                 tmp_v = builder->CreateFNeg(operand, "negtmp");
-                tmp_t = real_t;
             }
             else {
                 tmp_v = builder->CreateNeg(operand, "negtmp");
-                tmp_t = int_t;
             }
             break;
 
         case ast::OperatorEnum::NOT:
             tmp_v = builder->CreateNot(operand, "nottmp");
-            tmp_t = bool_t;
             break;
     }
 
     BLOCK_E("UnaryExpression")
 }
 
-// Sets tmp_v and tmp_t
+// Sets tmp_v. Both operands have the same type.
 void IRGenerator::visit(ast::BinaryExpression *exp) {
     BLOCK_B("BinaryExpression")
 
@@ -334,18 +891,8 @@ void IRGenerator::visit(ast::BinaryExpression *exp) {
     exp->rhs->accept(this);
     llvm::Value *R = pop_v();
     
-    bool float_exp = false, bool_exp = false;
-    if(L->getType()->isFloatingPointTy() && R->getType()->isIntegerTy()) {
-        float_exp = true;
-        R = builder->CreateUIToFP(R, real_t);
-    }
-    else if(L->getType()->isIntegerTy() && R->getType()->isFloatingPointTy()) {
-        float_exp = true;
-        L = builder->CreateUIToFP(L, real_t);
-    }
-    else if (L->getType()->isFloatingPointTy() && R->getType()->isFloatingPointTy()) {
-        float_exp = true;
-    }
+    bool float_exp = exp->lhs->dtype->getType() == ast::TypeEnum::REAL;
+    bool bool_exp = exp->lhs->dtype->getType() == ast::TypeEnum::BOOL; // false < true: compared unsigned
 
     switch (exp->op) {
         case ast::OperatorEnum::PLUS:
@@ -373,53 +920,48 @@ void IRGenerator::visit(ast::BinaryExpression *exp) {
             break;
 
         case ast::OperatorEnum::AND:
-            bool_exp = true;
             tmp_v = builder->CreateAnd(L, R, "andtmp");
             break;
 
         case ast::OperatorEnum::OR:
-            bool_exp = true;
             tmp_v = builder->CreateOr(L, R, "ortmp");
             break;
         
         case ast::OperatorEnum::XOR:
-            bool_exp = true;
             tmp_v = builder->CreateXor(L, R, "xortmp");
             break;
         
         case ast::OperatorEnum::EQ:
-            bool_exp = true;
             if(float_exp) tmp_v = builder->CreateFCmpUEQ(L, R, "eqtmp");
             else tmp_v = builder->CreateICmpEQ(L, R, "eqtmp");
             break;
 
         case ast::OperatorEnum::NEQ:
-            bool_exp = true;
             if(float_exp) tmp_v = builder->CreateFCmpUNE(L, R, "netmp");
             else tmp_v = builder->CreateICmpNE(L, R, "netmp");
             break;
 
         case ast::OperatorEnum::GT:
-            bool_exp = true;
             if(float_exp) tmp_v = builder->CreateFCmpUGT(L, R, "gttmp");
+            else if(bool_exp) tmp_v = builder->CreateICmpUGT(L, R, "gttmp");
             else tmp_v = builder->CreateICmpSGT(L, R, "gttmp");
             break;
 
         case ast::OperatorEnum::LT:
-            bool_exp = true;
             if(float_exp) tmp_v = builder->CreateFCmpULT(L, R, "lttmp");
+            else if(bool_exp) tmp_v = builder->CreateICmpULT(L, R, "lttmp");
             else tmp_v = builder->CreateICmpSLT(L, R, "lttmp");
             break;
         
         case ast::OperatorEnum::GEQ:
-            bool_exp = true;
             if(float_exp) tmp_v = builder->CreateFCmpUGE(L, R, "geqtmp");
+            else if(bool_exp) tmp_v = builder->CreateICmpUGE(L, R, "geqtmp");
             else tmp_v = builder->CreateICmpSGE(L, R, "geqtmp");
             break;
         
         case ast::OperatorEnum::LEQ:
-            bool_exp = true;
             if(float_exp) tmp_v = builder->CreateFCmpULE(L, R, "leqtmp");
+            else if(bool_exp) tmp_v = builder->CreateICmpULE(L, R, "leqtmp");
             else tmp_v = builder->CreateICmpSLE(L, R, "leqtmp");
             break;
         
@@ -427,53 +969,91 @@ void IRGenerator::visit(ast::BinaryExpression *exp) {
             GERROR("Unknown operator encountered")
     }
 
-    if(bool_exp) {
-        tmp_t = bool_t;
-    }
-    else if(float_exp) {
-        tmp_t = real_t;
-    }
-    else {
-        tmp_t = int_t;
-    }
-
     BLOCK_E("BinaryExpression")
 }
 
-void IRGenerator::visit(ast::IntType *it) {
-    tmp_t = int_t;
-}
+// Types are mapped by llvm_type
+void IRGenerator::visit(ast::IntType *it) {}
+void IRGenerator::visit(ast::RealType *rt) {}
+void IRGenerator::visit(ast::BoolType *bt) {}
 
-void IRGenerator::visit(ast::RealType *rt) {
-    tmp_t = real_t;
-}
-
-void IRGenerator::visit(ast::BoolType *bt) {
-    tmp_t = bool_t;
+// Array variables are allocated by declare_array
+void IRGenerator::visit(ast::ArrayType *at) {
+    BLOCK_B("ArrayType")
+    BLOCK_E("ArrayType")
 }
 
-// Sets tmp_p (pointer to the beginning of array)
-void IRGenerator::visit(ast::ArrayType *at) {
+// Allocates an array and returns a pointer to its first element, with the element type. Global
+// arrays and small arrays of constant size get static storage (a global or an entry-block alloca);
+// larger or dynamically sized local arrays are malloc'ed and freed when their body is left.
+Variable IRGenerator::declare_array(ast::ArrayType *at, const std::string &name) {
     BLOCK_B("ArrayType")
 
-    if(global_vars_pass) {
-        GERROR("Global arrays are not supported")
+    auto dtype = llvm_type(at->dtype);
+    if(!dtype) {
+        GERROR("Arrays of arrays or records are not supported")
     }
 
-    if(signature_pass) {
-        BLOCK_E("ArrayType")
-        return;
-    }
-    
     at->size->accept(this);
     auto size = pop_v();
 
-    at->dtype->accept(this);
-    auto dtype = pop_t();
+    auto count = llvm::dyn_cast<llvm::ConstantInt>(size);
+    if(count && count->isNegative()) {
+        GERROR("Array " << name << " has a negative size")
+    }
+    uint64_t elem_size = module->getDataLayout().getTypeAllocSize(dtype);
+    auto zero = llvm::ConstantInt::get(int_t, 0);
 
-    tmp_p = builder->CreateAlloca(dtype, size);
+    llvm::Value *p;
+    if(global_vars_pass) {
+        if(!count) {
+            GERROR("Global array " << name << " must have a constant size")
+        }
+        auto array_t = llvm::ArrayType::get(dtype, count->getZExtValue());
+        module->getOrInsertGlobal(name, array_t);
+        auto g = module->getNamedGlobal(name);
+        g->setLinkage(linkage(name));
+        if(partition == 0) {
+            g->setInitializer(llvm::ConstantAggregateZero::get(array_t));
+        }
+        p = llvm::ConstantExpr::getInBoundsGetElementPtr(array_t, g, llvm::ArrayRef<llvm::Constant*>{zero, zero});
+    }
+    else if(count && count->getZExtValue() * elem_size <= MAX_STACK_ARRAY) {
+        auto array_t = llvm::ArrayType::get(dtype, count->getZExtValue());
+        auto a = create_entry_alloca(array_t, name);
+        p = builder->CreateInBoundsGEP(array_t, a, {zero, zero}, name);
+    }
+    else {
+        auto i8p_t = llvm::Type::getInt8PtrTy(*context);
+        auto malloc_fn = module->getOrInsertFunction("malloc", i8p_t, int_t);
+        if(auto f = llvm::dyn_cast<llvm::Function>(malloc_fn.getCallee())) {
+            f->addRetAttr(llvm::Attribute::NoAlias); // every array is a distinct object
+        }
+        auto bytes = builder->CreateNUWMul(size, llvm::ConstantInt::get(int_t, elem_size), name + ".bytes");
+        auto raw = builder->CreateCall(malloc_fn, {bytes}, name + ".raw");
+        heap_arrays.push_back(raw);
+        p = builder->CreateBitCast(raw, dtype->getPointerTo(), name);
+    }
+
+    array_sizes[p] = size;
 
     BLOCK_E("ArrayType")
+    return {p, dtype};
+}
+
+// Frees the heap arrays allocated since mark (at the end of a body or before a return).
+void IRGenerator::free_heap_arrays(size_t mark) {
+    auto free_fn = module->getOrInsertFunction("free", llvm::Type::getVoidTy(*context), llvm::Type::getInt8PtrTy(*context));
+    for(size_t i = heap_arrays.size(); i > mark; i--) {
+        builder->CreateCall(free_fn, {heap_arrays[i - 1]});
+    }
+}
+
+// Allocas go to the entry block (in declaration order), so locals of loop bodies do not grow
+// the stack every iteration.
+llvm::AllocaInst *IRGenerator::create_entry_alloca(llvm::Type *dtype, const std::string &name) {
+    llvm::IRBuilder<> entry_builder(alloca_point);
+    return entry_builder.CreateAlloca(dtype, nullptr, name);
 }
 
 void IRGenerator::visit(ast::RecordType *rt) {
@@ -482,44 +1062,47 @@ void IRGenerator::visit(ast::RecordType *rt) {
     if(global_vars_pass) {
         GERROR("Global records are not supported")
     }
-    
-    if(signature_pass) {
-        BLOCK_E("RecordType")
-        return;
-    }
+
+    BLOCK_E("RecordType")
+}
+
+// Declares a variable "{name}.{field}" for every field, which is how the lexer spells field accesses.
+void IRGenerator::declare_record(ast::RecordType *rt, const std::string &name) {
+    rt->accept(this);
 
     for (auto& field : rt->fields) {
-        field->name = rt->name + "." + field->name;
-        field->accept(this); // Creates a var with name "{rt->name}.{field->name}"
+        std::string field_name = name + "." + symbols->name(field->name);
+        declare_variable(field, field_name, symbols->find(field_name));
     }
-
-    BLOCK_E("RecordType")
 }
 
 void IRGenerator::visit(ast::IntLiteral *il) {
-    tmp_v = llvm::ConstantInt::get(context, llvm::APInt(64, il->value, true));
-    tmp_t = int_t;
+    tmp_v = llvm::ConstantInt::get(*context, llvm::APInt(64, il->value, true));
 }
 
 void IRGenerator::visit(ast::RealLiteral *rl) {
-    tmp_v = llvm::ConstantFP::get(context, llvm::APFloat(rl->value));
-    tmp_t = real_t;
+    tmp_v = llvm::ConstantFP::get(*context, llvm::APFloat(rl->value));
 }
 
 void IRGenerator::visit(ast::BoolLiteral *bl) {
-    tmp_v = llvm::ConstantInt::get(context, llvm::APInt(1, bl->value, false));
-    tmp_t = bool_t;
+    tmp_v = llvm::ConstantInt::get(*context, llvm::APInt(1, bl->value, false));
 }
 
-// Sets tmp_v (the function pointer)
-void IRGenerator::visit(ast::RoutineDeclaration *routine) {
-    BLOCK_B("RoutineDeclaration")
+// Only main is called from outside a program compiled as one module, so everything else is
+// internal there: the inliner may then drop routines it inlined everywhere, and IPSCCP and dead
+// argument elimination may rewrite their signatures. Partitions refer to each other's definitions.
+llvm::GlobalValue::LinkageTypes IRGenerator::linkage(const std::string &name) const {
+    if(partitions > 1 || name == "main") {
+        return llvm::GlobalValue::ExternalLinkage;
+    }
+    return llvm::GlobalValue::InternalLinkage;
+}
 
-    signature_pass = true;
-    llvm::Type *rtype = llvm::Type::getVoidTy(context);
+// Creates the llvm::Function for a routine signature and binds it to the routine name
+llvm::Function *IRGenerator::declare_routine(ast::RoutineDeclaration *routine) {
+    llvm::Type *rtype = llvm::Type::getVoidTy(*context);
     if (routine->rtype) {
-        routine->rtype->accept(this);
-        auto dtype = pop_t();
+        auto dtype = llvm_type(routine->rtype);
         if(!dtype) {
             GERROR("Returning non-primitives from routines is not supported")
         }
@@ -528,48 +1111,92 @@ void IRGenerator::visit(ast::RoutineDeclaration *routine) {
 
     std::vector<llvm::Type*> param_types;
     for (auto& param : routine->params) {
-        param->dtype->accept(this);
-        auto dtype = pop_t();
+        auto dtype = llvm_type(param->dtype);
         if(!dtype) {
             GERROR("Passing non-primitives to routines is not supported")
         }
         param_types.push_back(dtype);
     }
-    signature_pass = false;
 
+    // Routines defined in another module, and every routine of a module written out (-c, -S,
+    // -emit-llvm-bc) to be linked with others, are external.
+    auto link = routine->body && shell.emit == cplus::Emit::EXECUTABLE ? linkage(symbols->name(routine->name)) : llvm::GlobalValue::ExternalLinkage;
     llvm::FunctionType *ft = llvm::FunctionType::get(rtype, param_types, false);
     llvm::Function *to_call = llvm::Function::Create(
         ft,
-        llvm::Function::ExternalLinkage,
-        routine->name,
+        link,
+        symbols->name(routine->name),
         module.get()
     );
+    routines.bind(routine->name, to_call);
 
-    unsigned idx = 0;
-    for (auto& arg : to_call->args()) {
-        arg.setName(routine->params[idx++]->name);
+    if(routine->inline_hint) {
+        to_call->addFnAttr(shell.always_inline ? llvm::Attribute::AlwaysInline : llvm::Attribute::InlineHint);
     }
+    // The inliner reads the threshold from the caller, so this applies to calls made from within this routine
+    if(shell.inline_threshold >= 0) {
+        to_call->addFnAttr("function-inline-threshold", std::to_string(shell.inline_threshold));
+    }
+
+    // Per-function target, which the optimizer's cost model and the inliner consult
+    to_call->addFnAttr("target-cpu", shell.cpu);
+    if(!shell.features.empty()) {
+        to_call->addFnAttr("target-features", shell.features);
+    }
+
+    return to_call;
+}
 
-    llvm::BasicBlock *bb = llvm::BasicBlock::Create(context, "entry", to_call);
+// Sets tmp_v (the function pointer)
+void IRGenerator::visit(ast::RoutineDeclaration *routine) {
+    BLOCK_B("RoutineDeclaration")
+
+    auto to_call = routines.lookup(routine->name);
+    if(!to_call) {
+        to_call = declare_routine(routine);
+    }
+    llvm::Type *rtype = to_call->getReturnType();
+
+    llvm::BasicBlock *bb = llvm::BasicBlock::Create(*context, "entry", to_call);
     builder->SetInsertPoint(bb);
 
-    args_table.clear();
-    idx = 0;
+    // Placeholder that marks the end of the entry block's allocas
+    alloca_point = new llvm::BitCastInst(llvm::UndefValue::get(int_t), int_t, "allocapt", bb);
+
+    // Parameters live in stack slots like other locals, so they can be assigned to.
+    scopes.push();
+    unsigned idx = 0;
     for (auto& arg : to_call->args()) {
-        args_table[arg.getName().str()] = &arg;
+        auto param = routine->params[idx++]->name;
+        arg.setName(symbols->name(param));
+        auto p = create_entry_alloca(arg.getType(), symbols->name(param) + ".addr");
+        builder->CreateStore(&arg, p);
+        scopes.bind(param, {p, arg.getType()});
     }
 
-    // Create globals needed for PrintStatement
-    if(is_first_routine) {
-        fmt_lld = builder->CreateGlobalStringPtr(llvm::StringRef("%lld"), "fmt_lld");
-        fmt_f = builder->CreateGlobalStringPtr(llvm::StringRef("%f"), "fmt_f");
-        fmt_s = builder->CreateGlobalStringPtr(llvm::StringRef("%s"), "fmt_s");
-        fmt_lld_ln = builder->CreateGlobalStringPtr(llvm::StringRef("%lld\n"), "fmt_lld_ln");
-        fmt_f_ln = builder->CreateGlobalStringPtr(llvm::StringRef("%f\n"), "fmt_f_ln");
-        fmt_s_ln = builder->CreateGlobalStringPtr(llvm::StringRef("%s\n"), "fmt_s_ln");
+    // Output of the program is flushed at every newline instead of when the runtime sees fit
+    if(shell.line_buffered && symbols->name(routine->name) == "main") {
+        auto flag = module->getOrInsertGlobal("cplus_line_buffered", llvm::Type::getInt32Ty(*context));
+        builder->CreateStore(llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context), 1), flag);
     }
 
     routine->body->accept(this);
+
+    // Routine fell off its end without a return statement.
+    if(!builder->GetInsertBlock()->getTerminator()) {
+        if(rtype->isVoidTy()) {
+            builder->CreateRetVoid();
+        }
+        else {
+            builder->CreateRet(llvm::Constant::getNullValue(rtype));
+        }
+    }
+
+    scopes.pop();
+
+    alloca_point->eraseFromParent();
+    alloca_point = nullptr;
+
     llvm::verifyFunction(*to_call);
     tmp_v = to_call;
 
@@ -579,20 +1206,26 @@ void IRGenerator::visit(ast::RoutineDeclaration *routine) {
 void IRGenerator::visit(ast::Body *body) {
     BLOCK_B("Body")
 
-    auto vars = body->variables;
-    auto stmts = body->statements;
-
-    // Parse tree pushed them in reverse order.
-    std::reverse(vars.begin(), vars.end());
-    std::reverse(stmts.begin(), stmts.end());
+    scopes.push();
+    size_t heap_mark = heap_arrays.size();
 
-    for (auto& var : vars) {
+    for (auto& var : body->variables) {
         var->accept(this);
     }
-    for (auto& stmt : stmts) {
+    for (auto& stmt : body->statements) {
+        // Statements following a return are unreachable.
+        if(builder->GetInsertBlock()->getTerminator()) {
+            break;
+        }
         stmt->accept(this);
     }
 
+    if(!builder->GetInsertBlock()->getTerminator()) {
+        free_heap_arrays(heap_mark);
+    }
+    heap_arrays.resize(heap_mark);
+    scopes.pop();
+
     BLOCK_E("Body")
 }
 
@@ -604,6 +1237,7 @@ void IRGenerator::visit(ast::ReturnStatement *stmt) {
         stmt->exp->accept(this);
         rval = pop_v();
     }
+    free_heap_arrays(0);
     tmp_v = builder->CreateRet(rval);
 
     BLOCK_E("ReturnStatement")
@@ -612,14 +1246,17 @@ void IRGenerator::visit(ast::ReturnStatement *stmt) {
 void IRGenerator::visit(ast::PrintStatement *stmt) {
     BLOCK_B("PrintStatement")
 
-    llvm::Value *to_print;
-    llvm::Type *dtype;
-    llvm::Constant *fmt;
+    auto i8p_t = llvm::Type::getInt8PtrTy(*context);
+    auto i32_t = llvm::Type::getInt32Ty(*context);
+    auto void_t = llvm::Type::getVoidTy(*context);
+    llvm::FunctionCallee write;
+    std::vector<llvm::Value*> args;
 
-    // Printing a constant string
+    // Printing a constant string, whose length is known here
     if(stmt->str) {
-        fmt = stmt->endl ? fmt_s_ln : fmt_s;
-        to_print = builder->CreateGlobalStringPtr(llvm::StringRef(*stmt->str), "str");
+        write = module->getOrInsertFunction("cplus_write_str", void_t, i8p_t, int_t, i32_t);
+        args.push_back(builder->CreateGlobalStringPtr(llvm::StringRef(*stmt->str), "str"));
+        args.push_back(llvm::ConstantInt::get(int_t, stmt->str->size()));
     }
 
     // Printing an expression
@@ -627,49 +1264,34 @@ void IRGenerator::visit(ast::PrintStatement *stmt) {
         stmt->exp->accept(this);
 
         // Get exp value
-        to_print = pop_v();
+        llvm::Value *to_print = pop_v();
         if(!to_print) {
             GERROR("Trying to print an unassigned value")
         }
 
-        // Get exp dtype
-        dtype = pop_t();
-        if(!dtype) { // Happens when printing a constant value
-            dtype = to_print->getType();
-        }
-        
-        // Setting format string for printf depending on exp type
+        llvm::Type *dtype = llvm_type(stmt->exp->dtype);
+
+        // Pick the runtime writer for the exp type
         if (dtype->isIntegerTy()) {
-            fmt = stmt->endl ? fmt_lld_ln : fmt_lld;
+            write = module->getOrInsertFunction("cplus_write_i64", void_t, int_t, i32_t);
+            if (dtype == bool_t) { // printed as 0 or 1
+                to_print = builder->CreateZExt(to_print, int_t);
+            }
         }
         else if (dtype->isFloatingPointTy()) {
-            fmt = stmt->endl ? fmt_f_ln : fmt_f;
+            write = module->getOrInsertFunction("cplus_write_f64", void_t, real_t, i32_t);
         }
         else {
-            std::cerr << RED << "[LLVM]: [ERROR]: Cannot print " << RESET << std::flush;
-            to_print->print(llvm::errs());
-            std::exit(1);
-        }
-    }
-
-    // Add function call code
-    std::vector<llvm::Value*> tmp;
-    tmp.push_back(fmt);
-    tmp.push_back(to_print);
-    auto args = llvm::ArrayRef<llvm::Value*>(tmp);
-
-    // Printf function callee
-    llvm::FunctionCallee print = module->getOrInsertFunction(
-        "printf",
-        llvm::FunctionType::get(
-            llvm::IntegerType::getInt64Ty(context),
-            llvm::PointerType::get(llvm::Type::getInt8Ty(context), 0),
-            true
-        )
-    );
-    
-    // Create function call
-    builder->CreateCall(print, args, "printfCall");
+            std::string value;
+            llvm::raw_string_ostream out(value);
+            out << *to_print;
+            GERROR("Cannot print " << out.str())
+        }
+        args.push_back(to_print);
+    }
+
+    args.push_back(llvm::ConstantInt::get(i32_t, stmt->endl));
+    builder->CreateCall(write, args);
 
     BLOCK_E("PrintStatement")
 }
@@ -677,53 +1299,38 @@ void IRGenerator::visit(ast::PrintStatement *stmt) {
 void IRGenerator::visit(ast::AssignmentStatement *stmt) {
     BLOCK_B("AssignmentStatement")
 
-    // id_loc is a pointer to the modifiable_primary to be accessed
-    stmt->id->accept(this);
-    auto id_loc = pop_p();
+    // The target is only written, so its address is all that is needed
+    Variable target = address(stmt->id);
 
     // exp is a Value* containing the new data
     stmt->exp->accept(this);
     auto exp = pop_v();
-
-    exp = cast_primitive(exp, builder->CreateLoad(id_loc)->getType(), exp->getType());
     
-    builder->CreateStore(exp, id_loc);
+    builder->CreateStore(exp, target.p);
 
     BLOCK_E("AssignmentStatement")
 }
 
-// Returns the bool condition from if/while expression
-llvm::Value *IRGenerator::exp_to_bool(llvm::Value *cond) {
-    auto dtype = cond->getType();
-
-    if(dtype == bool_t) {
-        return cond;
-    }
-    else if(dtype == int_t) {
-        return builder->CreateICmpNE(cond, llvm::ConstantInt::get(context, llvm::APInt(64, 0)), "cond");
-    }
-    else if(dtype == real_t) {
-        return builder->CreateFCmpUNE(cond, llvm::ConstantFP::get(context, llvm::APFloat(0.0)), "cond");
-    }
-    else {
-        GERROR("condition expression is not of integer or boolean type")
+// Branches to the given block unless the current block already returned
+void IRGenerator::branch_to(llvm::BasicBlock *block) {
+    if(!builder->GetInsertBlock()->getTerminator()) {
+        builder->CreateBr(block);
     }
 }
 
-
 void IRGenerator::visit(ast::IfStatement *stmt) {
     BLOCK_B("IfStatement")
 
     stmt->cond->accept(this);
-    auto cond = exp_to_bool(pop_v());
+    auto cond = pop_v();
 
     // Get the current function
     llvm::Function *func = builder->GetInsertBlock()->getParent();
 
     // Create blocks for the then, else, endif.
-    llvm::BasicBlock *then_block = llvm::BasicBlock::Create(context, "then", func);
-    llvm::BasicBlock *else_block = stmt->else_body ? llvm::BasicBlock::Create(context, "else") : nullptr;
-    llvm::BasicBlock *endif = llvm::BasicBlock::Create(context, "endif");
+    llvm::BasicBlock *then_block = llvm::BasicBlock::Create(*context, "then", func);
+    llvm::BasicBlock *else_block = stmt->else_body ? llvm::BasicBlock::Create(*context, "else") : nullptr;
+    llvm::BasicBlock *endif = llvm::BasicBlock::Create(*context, "endif");
 
     // Create the conditional statement
     builder->CreateCondBr(cond, then_block, else_block ? else_block : endif);
@@ -732,7 +1339,7 @@ void IRGenerator::visit(ast::IfStatement *stmt) {
     {
         builder->SetInsertPoint(then_block);
         stmt->then_body->accept(this);
-        builder->CreateBr(endif);
+        branch_to(endif);
         
         then_block = builder->GetInsertBlock();
     }
@@ -743,7 +1350,7 @@ void IRGenerator::visit(ast::IfStatement *stmt) {
 
         builder->SetInsertPoint(else_block);
         stmt->else_body->accept(this);
-        builder->CreateBr(endif);
+        branch_to(endif);
 
         else_block = builder->GetInsertBlock();
     }
@@ -762,16 +1369,16 @@ void IRGenerator::visit(ast::WhileLoop *stmt) {
     
     llvm::Function *parent = builder->GetInsertBlock()->getParent();
 
-    llvm::BasicBlock *cond_block = llvm::BasicBlock::Create(context, "cond", parent);
-    llvm::BasicBlock *loop_block = llvm::BasicBlock::Create(context, "loop");
-    llvm::BasicBlock *end_block = llvm::BasicBlock::Create(context, "loopend");
+    llvm::BasicBlock *cond_block = llvm::BasicBlock::Create(*context, "cond", parent);
+    llvm::BasicBlock *loop_block = llvm::BasicBlock::Create(*context, "loop");
+    llvm::BasicBlock *end_block = llvm::BasicBlock::Create(*context, "loopend");
 
     // Condition
     {
         builder->CreateBr(cond_block);
         builder->SetInsertPoint(cond_block);
         stmt->cond->accept(this);
-        auto cond = exp_to_bool(pop_v());
+        auto cond = pop_v();
         builder->CreateCondBr(cond, loop_block, end_block);
     }
 
@@ -780,7 +1387,11 @@ void IRGenerator::visit(ast::WhileLoop *stmt) {
         parent->getBasicBlockList().push_back(loop_block);
         builder->SetInsertPoint(loop_block);
         stmt->body->accept(this);
-        builder->CreateBr(cond_block);
+        auto latch = builder->GetInsertBlock();
+        if(!latch->getTerminator()) {
+            branch_to(cond_block);
+            set_loop_metadata(latch->getTerminator(), stmt->offset, false);
+        }
     }
     
     // End
@@ -792,35 +1403,71 @@ void IRGenerator::visit(ast::WhileLoop *stmt) {
     BLOCK_E("WhileLoop")
 }
 
-// For loop is just a fancy while loop :)
+// Lowers a for loop into a guarded, bottom-tested loop whose counter is a phi. The bounds are
+// evaluated once; an integer loop exits when the counter reaches the last value, so it cannot
+// overflow and its trip count (last - first + 1) is visible to the loop optimizations.
 void IRGenerator::visit(ast::ForLoop *stmt) {
     BLOCK_B("ForLoop")
     
     llvm::Function *parent = builder->GetInsertBlock()->getParent();
 
-    llvm::BasicBlock *cond_block = llvm::BasicBlock::Create(context, "cond", parent);
-    llvm::BasicBlock *loop_block = llvm::BasicBlock::Create(context, "loop");
-    llvm::BasicBlock *end_block = llvm::BasicBlock::Create(context, "loopend");
-
-    // Declare loop var
-    stmt->loop_var->accept(this);
-
-    // Condition
-    {
-        builder->CreateBr(cond_block);
-        builder->SetInsertPoint(cond_block);
-        stmt->cond->accept(this);
-        auto cond = exp_to_bool(pop_v());
-        builder->CreateCondBr(cond, loop_block, end_block);
+    llvm::BasicBlock *loop_block = llvm::BasicBlock::Create(*context, "loop");
+    llvm::BasicBlock *end_block = llvm::BasicBlock::Create(*context, "loopend");
+
+    // Bounds: both have the type of the counter
+    stmt->from->accept(this);
+    auto from = pop_v();
+    stmt->to->accept(this);
+    auto to = pop_v();
+    auto first = stmt->reverse ? to : from;
+    auto last = stmt->reverse ? from : to;
+
+    llvm::Type *dtype = llvm_type(stmt->from->dtype);
+    bool is_int = dtype == int_t;
+
+    // The body sees the counter through a stack slot, like any other local.
+    scopes.push();
+    auto loop_var = create_entry_alloca(dtype, symbols->name(stmt->loop_var));
+    scopes.bind(stmt->loop_var, {loop_var, dtype});
+
+    // Guard: skip empty ranges
+    llvm::BasicBlock *preheader = builder->GetInsertBlock();
+    llvm::Value *enter;
+    if(is_int) {
+        enter = stmt->reverse ? builder->CreateICmpSGE(first, last, "enter") : builder->CreateICmpSLE(first, last, "enter");
     }
+    else {
+        enter = stmt->reverse ? builder->CreateFCmpOGE(first, last, "enter") : builder->CreateFCmpOLE(first, last, "enter");
+    }
+    builder->CreateCondBr(enter, loop_block, end_block);
 
     // Loop
     {
         parent->getBasicBlockList().push_back(loop_block);
         builder->SetInsertPoint(loop_block);
+        auto counter = builder->CreatePHI(dtype, 2, symbols->name(stmt->loop_var));
+        counter->addIncoming(first, preheader);
+        builder->CreateStore(counter, loop_var);
+
         stmt->body->accept(this);
-        stmt->action->accept(this); // do the loop action.
-        builder->CreateBr(cond_block);
+
+        // Latch: step the counter and loop back unless the last value was just done
+        if(!builder->GetInsertBlock()->getTerminator()) {
+            llvm::Value *done;
+            llvm::Value *next;
+            if(is_int) {
+                done = builder->CreateICmpEQ(counter, last, "done");
+                auto step = llvm::ConstantInt::get(int_t, stmt->reverse ? -1 : 1, true);
+                next = builder->CreateNSWAdd(counter, step, "next");
+            }
+            else {
+                next = builder->CreateFAdd(counter, llvm::ConstantFP::get(real_t, stmt->reverse ? -1.0 : 1.0), "next");
+                done = stmt->reverse ? builder->CreateFCmpOLT(next, last, "done") : builder->CreateFCmpOGT(next, last, "done");
+            }
+            counter->addIncoming(next, builder->GetInsertBlock());
+            auto latch = builder->CreateCondBr(done, end_block, loop_block);
+            set_loop_metadata(latch, stmt->offset, is_int); // an integer counter always reaches last
+        }
     }
     
     // End
@@ -829,21 +1476,20 @@ void IRGenerator::visit(ast::ForLoop *stmt) {
         builder->SetInsertPoint(end_block);
     }
 
+    scopes.pop();
+
     BLOCK_E("ForLoop")
 }
 
 void IRGenerator::visit(ast::RoutineCall *stmt) {
     BLOCK_B("RoutineCall")
 
-    llvm::Function *routine = module->getFunction(stmt->routine->name);
+    auto routine = routines.lookup(stmt->name);
     if (!routine) {
-        GERROR("Routine " << stmt->routine->name << " is not declared")
-    }
-
-    if (routine->arg_size() != stmt->args.size()) {
-        GERROR("Arity mismatch. Expected: " << stmt->args.size() << ". Got: " << routine->arg_size())
+        GERROR("Routine " << symbols->name(stmt->name) << " is not declared")
     }
 
+    // Arity and argument types were checked by the semantic pass
     std::vector<llvm::Value*> args;
     for (auto& arg : stmt->args) {
         arg->accept(this);
@@ -851,22 +1497,6 @@ void IRGenerator::visit(ast::RoutineCall *stmt) {
     }
 
     tmp_v = builder->CreateCall(routine, args);
-    switch(stmt->routine->rtype->getType()) {
-        case ast::TypeEnum::INT:
-            tmp_t = int_t;
-            break;
-
-        case ast::TypeEnum::REAL:
-            tmp_t = real_t;
-            break;
-
-        case ast::TypeEnum::BOOL:
-            tmp_t = bool_t;
-            break;
-        
-        default:
-            GERROR("Rtype is non-primitive")
-    }
     
     BLOCK_E("RoutineCall")
 }
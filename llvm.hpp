@@ -5,20 +5,104 @@
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LLVMContext.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/IR/LegacyPassManager.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/Program.h"
+#if LLVM_VERSION_MAJOR >= 14
+#include "llvm/MC/TargetRegistry.h"
+#else
 #include "llvm/Support/TargetRegistry.h"
+#endif
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Target/TargetMachine.h"
 #include "llvm/Target/TargetOptions.h"
 
+#include <stdexcept>
+
 #include "ast.hpp"
 #include "shell.hpp"
 
+// Host target machine and optimization pipeline for one -O level.
+// Created once per thread and shared by every IRGenerator running on it (none of it is thread-safe).
+struct Pipeline {
+    std::unique_ptr<llvm::TargetMachine> target_machine;
+    std::unique_ptr<llvm::PassBuilder> pb;
+    llvm::LoopAnalysisManager lam;
+    llvm::FunctionAnalysisManager fam;
+    llvm::CGSCCAnalysisManager cgam;
+    llvm::ModuleAnalysisManager mam;
+    llvm::ModulePassManager mpm;
+};
+
+// A variable as codegen sees it: where it lives, and the type stored there (for arrays, the
+// element type, as p points to the first element).
+struct Variable {
+    llvm::Value *p = nullptr;
+    llvm::Type *dtype = nullptr;
+};
+
+// Innermost visible binding of every symbol, indexed directly by the (dense) symbol handle.
+// Bindings shadowed by an inner scope are saved on a stack and restored when it closes.
+template <typename Binding>
+class Scopes {
+public:
+    void push() {
+        marks.push_back(saved.size());
+    }
+
+    void pop() {
+        while (saved.size() > marks.back()) {
+            current[saved.back().first] = saved.back().second;
+            saved.pop_back();
+        }
+        marks.pop_back();
+    }
+
+    void bind(ast::Symbol sym, Binding value) {
+        if (sym >= current.size()) {
+            current.resize(sym + 1, Binding{});
+        }
+        saved.emplace_back(sym, current[sym]);
+        current[sym] = value;
+    }
+
+    Binding lookup(ast::Symbol sym) const {
+        return sym < current.size() ? current[sym] : Binding{};
+    }
+
+private:
+    std::vector<Binding> current;
+    std::vector<std::pair<ast::Symbol, Binding>> saved;
+    std::vector<size_t> marks;
+};
+
+// Unrecoverable code generation error. Fails the compilation that raised it, not the process.
+struct CodegenError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+class VectorizeReport;
+
 // Visits AST nodes and generates LLVM IR code.
+// With several partitions, each generator lowers every partitions-th routine of the program into
+// its own context and module; the partitions share the (read-only) AST and run on separate threads.
 class IRGenerator : public Visitor {
 public:
-    IRGenerator();
-    void generate();
+    IRGenerator(cplus::Shell &shell, cplus::TimeReport &report, unsigned partition = 0, unsigned partitions = 1);
+    static void warm_up();
+    void optimize();
+    void finalize();
+    void print_vectorize_report();
+    int generate(const std::string &path);
+    int run();
+    static int link_bitcode(const cplus::Options &options, cplus::TimeReport &report, const std::vector<std::string> &files,
+                            const std::string &objfile, bool whole_program);
+    static std::string runtime_library();
+    static int link(cplus::TimeReport &report, const std::vector<std::string> &objfiles, const std::string &outfile, bool instrumented = false);
     void visit(ast::Program *program) override;
     void visit(ast::IntType *it) override;
     void visit(ast::RealType *rt) override;
@@ -30,6 +114,7 @@ public:
     void visit(ast::BoolLiteral *bl) override;
     void visit(ast::VariableDeclaration *vardecl) override;
     void visit(ast::Identifier *id) override;
+    void visit(ast::Cast *cast) override;
     void visit(ast::UnaryExpression *exp) override;
     void visit(ast::BinaryExpression *exp) override;
     void visit(ast::RoutineDeclaration *routine) override;
@@ -42,30 +127,47 @@ public:
     void visit(ast::ForLoop *stmt) override;
     void visit(ast::RoutineCall *stmt) override;
 
-    llvm::Value *exp_to_bool(llvm::Value *cond);
+    llvm::Type *llvm_type(ast::Type *type);
     llvm::Value *cast_primitive(llvm::Value*, llvm::Type*, llvm::Type*);
+    void branch_to(llvm::BasicBlock *block);
+    llvm::Function *declare_routine(ast::RoutineDeclaration *routine);
+    llvm::GlobalValue::LinkageTypes linkage(const std::string &name) const;
+    void declare_variable(ast::VariableDeclaration *var, const std::string &name, ast::Symbol sym);
+    void declare_record(ast::RecordType *rt, const std::string &name);
+    Variable declare_array(ast::ArrayType *at, const std::string &name);
+    Variable address(ast::Identifier *id);
+    llvm::AllocaInst *create_entry_alloca(llvm::Type *dtype, const std::string &name);
+    void free_heap_arrays(size_t mark);
+    void check_bounds(llvm::Value *idx, llvm::Value *offset, llvm::Value *size);
+    void set_loop_metadata(llvm::Instruction *latch, size_t offset, bool finite);
 
 private:
-    llvm::LLVMContext context;
+    cplus::Shell &shell;
+    cplus::TimeReport &report;
+    unsigned partition, partitions;
+    std::unique_ptr<llvm::LLVMContext> context;
     std::unique_ptr<llvm::IRBuilder<>> builder;
     std::unique_ptr<llvm::Module> module;
-    std::map<std::string, llvm::Value*> ptrs_table;
-    std::map<std::string, llvm::Value*> args_table;
+    Pipeline *pipeline;
+    llvm::TargetMachine *target_machine;
+    ast::SymbolTable *symbols;
+    Scopes<Variable> scopes;          // globals, parameters and locals
+    Scopes<llvm::Function*> routines; // every declared routine
     
-    llvm::Value *tmp_v, *tmp_p;
-    llvm::Type *tmp_t;
+    std::vector<llvm::Value*> heap_arrays; // malloc'ed arrays of the enclosing bodies, innermost last
+    llvm::DenseMap<llvm::Value*, llvm::Value*> array_sizes; // element count of every declared array
+    llvm::Instruction *alloca_point = nullptr; // entry-block allocas are inserted before it
+    VectorizeReport *vectorize_report = nullptr; // owned by context, with --vectorize-report
+    std::vector<std::pair<unsigned, std::string>> loops; // source line and routine of each loop, by ID - 1, for the report
+
+    llvm::Value *tmp_v;
     llvm::IntegerType *int_t, *bool_t;
     llvm::Type *real_t;
-    llvm::Constant *fmt_lld, *fmt_lld_ln, *fmt_f, *fmt_f_ln, *fmt_s, *fmt_s_ln;
 
     int spaces = 0;
     bool global_vars_pass = true;
-    bool signature_pass = false;
-    bool is_first_routine = true;
 
     llvm::Value *pop_v();
-    llvm::Value *pop_p();
-    llvm::Type *pop_t();
 };
 
 #endif // LLVM_H
\ No newline at end of file
@@ -1,9 +1,21 @@
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <llvm/Support/ThreadPool.h>
 
 #include "lexer.h"
 #include "parser.hpp"
 #include "shell.hpp"
 #include "llvm.hpp"
+#include "cache.hpp"
+#include "fold.hpp"
+#include "semantic.hpp"
+#include "bounds.hpp"
 
 #define RED     "\033[31m"
 #define GREEN   "\033[32m"
@@ -11,42 +23,410 @@
 #define CYAN    "\033[36m"
 #define RESET   "\033[0m"
 
-extern cplus::Shell shell;
-extern ast::node_ptr<ast::Program> program;
+static std::mutex output_lock; // keeps the messages of concurrent compilations whole
 
-int main(int argc, char **argv) {
-        
-    if (shell.parse_args(argc, argv)) {
-        std::cerr << RESET << RED << "Error parsing arguments\n";
-        return 1;
+// Lowers, optimizes and emits the program into one object file per partition. Partitions
+// run on parallel threads, each with its own LLVMContext, and are linked together afterwards.
+static int generate(cplus::Shell &shell, const std::vector<std::string> &objfiles) {
+    unsigned partitions = objfiles.size();
+    if(partitions == 1) {
+        IRGenerator gen(shell, shell.report);
+        {
+            auto timer = shell.report.time("codegen");
+            shell.program->accept(&gen);
+        }
+        return gen.generate(objfiles[0]);
+    }
+
+    std::vector<cplus::TimeReport> reports(partitions);
+    std::vector<int> status(partitions, 0);
+    std::vector<std::string> errors(partitions);
+    {
+        auto timer = shell.report.time("codegen");
+        llvm::ThreadPool pool(llvm::hardware_concurrency(partitions));
+        for(unsigned k = 0; k < partitions; k++) {
+            reports[k].enabled = shell.report.enabled;
+            pool.async([&, k] {
+                try {
+                    IRGenerator gen(shell, reports[k], k, partitions);
+                    {
+                        auto timer = reports[k].time("codegen");
+                        shell.program->accept(&gen);
+                    }
+                    status[k] = gen.generate(objfiles[k]);
+                }
+                catch(const CodegenError &e) {
+                    errors[k] = e.what();
+                    status[k] = 1;
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    for(unsigned k = 0; k < partitions; k++) {
+        shell.report.merge(reports[k]);
+    }
+    for(unsigned k = 0; k < partitions; k++) {
+        if(!errors[k].empty()) {
+            throw CodegenError(errors[k]);
+        }
+    }
+    return std::count(status.begin(), status.end(), 0) == partitions ? 0 : 1;
+}
+
+// What a successful compilation tells the user
+static std::string written(const cplus::Options &options, const std::string &outfile) {
+    if(options.emit == cplus::Emit::EXECUTABLE) {
+        return "Run ./" + outfile + " to execute";
     }
+    return "Wrote " + outfile;
+}
 
+// Parses the program opened by the shell and runs the AST passes over it.
+static int analyze(cplus::Shell &shell) {
     if(shell.debug) {
         std::cout << "\n\n" << YELLOW << "[LEXER]" << RESET << " and " << GREEN << "[PARSER]" << RESET << ":" << std::endl;
     }
     
-    if (shell.parse_program()) {
+    int status;
+    {
+        auto timer = shell.report.time("parsing");
+        status = shell.parse_program();
+    }
+    if (status) {
         std::cerr << RESET << RED << "Error parsing program\n";
         return 1;
     }
     
+    {
+        auto timer = shell.report.time("semantic");
+        SemanticAnalyzer analyzer(*shell.program);
+        shell.program->accept(&analyzer);
+    }
+
+    {
+        auto timer = shell.report.time("folding");
+        ConstantFolder folder(*shell.program);
+        shell.program->accept(&folder);
+    }
+
+    if(shell.bounds_check) {
+        auto timer = shell.report.time("bounds");
+        BoundsCheckEliminator eliminator(*shell.program);
+        shell.program->accept(&eliminator);
+    }
+
     if(shell.debug) {
         std::cout << CYAN << "[AST]:" << RESET << std::endl;
     }
+    return 0;
+}
 
-    IRGenerator gen;
-    program->accept(&gen);
-    gen.generate();
+// Compiles (or runs) the program opened by the shell.
+static int compile(cplus::Shell &shell) {
+    // Debug output, reports and JIT runs need the full pipeline, so only plain builds use the cache.
+    std::unique_ptr<cplus::Cache> cache;
+    if(shell.cache && !shell.debug && !shell.run && !shell.time_report && !shell.vectorize_report) {
+        cache = std::make_unique<cplus::Cache>(shell);
+        if(cache->fetch(shell.outfile)) {
+            std::lock_guard<std::mutex> lock(output_lock);
+            std::cout << "\033[0m" << "Compilation successful (cached). " << written(shell, shell.outfile) << "\n";
+            return 0;
+        }
+    }
 
-    std::string cmd = "clang -x ir ir.ll -o \"" + shell.outfile + "\"";
-    
-    if(!system(cmd.c_str())) {
-        std::cout << "\033[0m" << "Compilation successful. Run ./" << shell.outfile << " to execute\n";
+    int status = analyze(shell);
+    if(status) {
+        return status;
+    }
+
+    if(shell.run) {
+        IRGenerator gen(shell, shell.report);
+        {
+            auto timer = shell.report.time("codegen");
+            shell.program->accept(&gen);
+        }
+        status = gen.run();
+        if(shell.report.enabled) {
+            std::lock_guard<std::mutex> lock(output_lock);
+            shell.report.print(std::cerr);
+        }
+        return status;
+    }
+
+    // Objects, assembly and bitcode are written straight to the outfile, as a single module.
+    if(shell.emit != cplus::Emit::EXECUTABLE) {
+        status = generate(shell, {shell.outfile});
+        std::lock_guard<std::mutex> lock(output_lock);
+        if(shell.report.enabled) {
+            shell.report.print(std::cerr);
+        }
+        if(status) {
+            std::cerr << RESET << RED << "Error generating " << shell.outfile << "\n";
+            return 1;
+        }
+        if(cache) {
+            cache->store(shell.outfile);
+        }
+        std::cout << "\033[0m" << "Compilation successful. " << written(shell, shell.outfile) << "\n";
+        return 0;
+    }
+
+    // Every partition needs at least one routine; debug output (foo.ll) needs a single module.
+    size_t partitions = shell.debug ? 1 : std::min<size_t>(shell.partitions, shell.program->routines.size());
+    std::vector<std::string> objfiles;
+    for(size_t k = 0; k < std::max<size_t>(partitions, 1); k++) {
+        llvm::SmallString<128> objfile;
+        if(llvm::sys::fs::createTemporaryFile("cplus", "o", objfile)) {
+            std::cerr << RESET << RED << "Error creating temporary object file\n";
+            status = 1;
+            break;
+        }
+        objfiles.push_back(objfile.str().str());
+    }
+
+    if(!status) {
+        status = generate(shell, objfiles) || IRGenerator::link(shell.report, objfiles, shell.outfile, !shell.profile_generate.empty());
+    }
+    for(auto &objfile : objfiles) {
+        llvm::sys::fs::remove(objfile);
+    }
+
+    std::lock_guard<std::mutex> lock(output_lock);
+    if(shell.report.enabled) {
+        shell.report.print(std::cerr);
+    }
+
+    if(!status) {
+        if(cache) {
+            cache->store(shell.outfile);
+        }
+        std::cout << "\033[0m" << "Compilation successful. " << written(shell, shell.outfile) << "\n";
     }
     else {
-        std::cerr << RESET << RED << "Error generating IR\n";
+        std::cerr << RESET << RED << "Error generating executable\n";
         return 1;
     }
     
     return 0;
-}
\ No newline at end of file
+}
+
+// Runs one compilation step, reporting the errors it throws. Errors fail only this compilation.
+template <typename Step>
+static int guarded(Step step) {
+    try {
+        return step();
+    }
+    catch(const SemanticError &e) {
+        std::lock_guard<std::mutex> lock(output_lock);
+        std::cerr << RESET << RED << "[SEMANTIC]: [ERROR]: " << e.what() << RESET << std::endl;
+        return 1;
+    }
+    catch(const CodegenError &e) {
+        std::lock_guard<std::mutex> lock(output_lock);
+        std::cerr << RESET << RED << "[LLVM]: [ERROR]: " << e.what() << RESET << std::endl;
+        return 1;
+    }
+}
+
+// Compiles (or runs) one infile.
+static int compile(const cplus::Options &options, const std::string &infile) {
+    cplus::Shell shell(options, infile);
+    if(shell.open()) {
+        return 1;
+    }
+    return guarded([&] { return compile(shell); });
+}
+
+// Compiles a source into an LLVM module for link_all.
+static int compile_module(const cplus::Options &options, const std::string &infile, cplus::TimeReport &report) {
+    cplus::Shell shell(options, infile);
+    if(shell.open()) {
+        return 1;
+    }
+    int status = guarded([&] {
+        if(int status = analyze(shell)) {
+            return status;
+        }
+        IRGenerator gen(shell, shell.report);
+        {
+            auto timer = shell.report.time("codegen");
+            shell.program->accept(&gen);
+        }
+        return gen.generate(shell.outfile);
+    });
+
+    std::lock_guard<std::mutex> lock(output_lock);
+    report.merge(shell.report);
+    return status;
+}
+
+// Links every infile into one executable: the sources are compiled into LLVM modules (in parallel,
+// as compile_all does), which are linked with the *.bc and *.ll infiles into one module. That module
+// is optimized as a whole and linked with the *.o and *.a infiles by the system linker.
+static int link_all(const cplus::Options &options) {
+    // Modules only get the pre-link pipeline (and the profile); the rest runs once on the linked module.
+    cplus::Options module_options = options;
+    module_options.emit = cplus::Emit::BITCODE;
+    module_options.link_module = true;
+
+    cplus::TimeReport report;
+    report.enabled = options.time_report;
+    report.json = options.time_report_json;
+
+    std::vector<std::string> modules, objfiles;
+    int status = 0;
+    auto temporary = [&](const char *extension, std::vector<std::string> &paths) {
+        llvm::SmallString<128> path;
+        if(llvm::sys::fs::createTemporaryFile("cplus", extension, path)) {
+            std::cerr << RESET << RED << "Error creating temporary file\n";
+            status = 1;
+        }
+        paths.push_back(path.str().str());
+    };
+    for(size_t i = 0; i < options.infiles.size() && !status; i++) {
+        temporary("bc", modules);
+    }
+    if(!status) {
+        temporary("o", objfiles);
+    }
+
+    if(!status) {
+        std::atomic<int> module_status{0};
+        auto compile_one = [&](size_t i) {
+            cplus::Options one = module_options;
+            one.outfile = modules[i];
+            module_status |= compile_module(one, options.infiles[i], report);
+        };
+        if(options.infiles.size() <= 1 || options.jobs == 1 || options.debug) {
+            for(size_t i = 0; i < options.infiles.size(); i++) {
+                compile_one(i);
+            }
+        }
+        else {
+            llvm::ThreadPool pool(llvm::hardware_concurrency(options.jobs));
+            for(size_t i = 0; i < options.infiles.size(); i++) {
+                pool.async(compile_one, i);
+            }
+            pool.wait();
+        }
+        status = module_status;
+    }
+
+    std::string outfile = options.outfile.empty() ? "a.out" : options.outfile;
+    if(!status) {
+        std::vector<std::string> files = modules;
+        files.insert(files.end(), options.bitcode.begin(), options.bitcode.end());
+        objfiles.insert(objfiles.end(), options.objects.begin(), options.objects.end());
+        status = guarded([&] {
+            return IRGenerator::link_bitcode(options, report, files, objfiles[0], options.objects.empty()) ||
+                   IRGenerator::link(report, objfiles, outfile, !options.profile_generate.empty());
+        });
+    }
+    for(auto &module : modules) {
+        llvm::sys::fs::remove(module);
+    }
+    if(!objfiles.empty()) {
+        llvm::sys::fs::remove(objfiles[0]);
+    }
+
+    if(report.enabled) {
+        report.print(std::cerr);
+    }
+    if(status) {
+        std::cerr << RESET << RED << "Error generating executable\n";
+        return 1;
+    }
+    std::cout << "\033[0m" << "Compilation successful. Run ./" << outfile << " to execute\n";
+    return 0;
+}
+
+// Compiles every infile, in parallel on up to options.jobs threads. Each compilation has
+// its own shell, AST and LLVMContext; debug output is only readable when they run in order.
+static int compile_all(const cplus::Options &options) {
+    if(options.infiles.size() == 1 || options.jobs == 1 || options.debug) {
+        int status = 0;
+        for(auto &infile : options.infiles) {
+            status |= compile(options, infile);
+        }
+        return status;
+    }
+
+    std::atomic<int> status{0};
+    llvm::ThreadPool pool(llvm::hardware_concurrency(options.jobs));
+    for(auto &infile : options.infiles) {
+        pool.async([&options, &status, &infile] {
+            status |= compile(options, infile);
+        });
+    }
+    pool.wait();
+    return status;
+}
+
+// Compile server: reads one job (the usual command line arguments) per line from stdin.
+// Targets and pass pipelines are initialized once; each job runs in a forked child that
+// inherits them, so a failing job cannot take the server down. Stdout carries only the
+// "<status> <job>" reply lines, all compiler output goes to stderr.
+int serve() {
+    IRGenerator::warm_up();
+    cplus::Cache::warm_up();
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (line.empty()) {
+            continue;
+        }
+
+        std::cout.flush();
+        pid_t pid = fork();
+        if (pid < 0) {
+            std::cerr << RESET << RED << "Error forking compile job\n";
+            return 1;
+        }
+
+        if (pid == 0) {
+            dup2(STDERR_FILENO, STDOUT_FILENO);
+
+            std::istringstream words(line);
+            std::vector<std::string> args = {"cplus"};
+            for (std::string word; words >> word; ) {
+                args.push_back(word);
+            }
+            std::vector<char*> argv;
+            for (auto& arg : args) {
+                argv.push_back(&arg[0]);
+            }
+            argv.push_back(nullptr); // argv[argc], as main() gets it
+
+            cplus::Options options;
+            if (options.parse_args(argv.size() - 1, argv.data()) || options.serve) {
+                std::exit(1);
+            }
+            int status = options.links() ? link_all(options) : compile_all(options);
+            std::cout.flush();
+            std::exit(status);
+        }
+
+        int status;
+        waitpid(pid, &status, 0);
+        int code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        std::cout << code << " " << line << std::endl;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    cplus::Options options;
+    if (options.parse_args(argc, argv)) {
+        std::cerr << RESET << RED << "Error parsing arguments\n";
+        return 1;
+    }
+
+    if (options.serve) {
+        return serve();
+    }
+
+    return options.links() ? link_all(options) : compile_all(options);
+}
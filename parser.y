@@ -12,6 +12,7 @@
 %lex-param   { cplus::Shell &shell }
 %parse-param { cplus::Lexer &lexer }
 %parse-param { cplus::Shell &shell }
+%parse-param { ast::Program &program }
 
 %token VAR ID IS INT_VAL REAL_VAL BOOL_VAL    // var <identifier> is \d+ \d+\.\d+ true|false
 %token TYPE_KW INT_KW REAL_KW BOOL_KW         // type integer real boolean
@@ -20,22 +21,24 @@
 %token PLUS MINUS MUL DIV MOD                 // + - * / %
 %token AND OR XOR NOT                         // and or xor not
 %token LT GT EQ LEQ GEQ NEQ                   // < > = <= >= /=
-%token ARRAY RECORD ROUTINE RETURN END        // array record routine return end
+%token ARRAY RECORD ROUTINE RETURN END INLINE // array record routine return end inline
 %token PRINT PRINTLN STRING                   // print println <string>
 %token IF THEN ELSE WHILE FOR IN LOOP REVERSE // if then else while for in loop reverse
 
-%type <std::string> ID STRING
+%type <ast::Symbol> ID
+%type <std::string_view> STRING
 %type <long long> INT_VAL
 %type <double> REAL_VAL
 %type <bool> BOOL_VAL
+%type <size_t> WHILE FOR                        // source offset of the keyword
 
 %type <ast::node_ptr<ast::VariableDeclaration>> VARIABLE_DECLARATION PARAMETER_DECLARATION
 %type <std::vector<ast::node_ptr<ast::VariableDeclaration>>> VARIABLE_DECLARATIONS
 %type <std::vector<ast::node_ptr<ast::VariableDeclaration>>> PARAMETERS NON_EMPTY_PARAMETERS 
-%type <ast::node_ptr<ast::RoutineDeclaration>> ROUTINE_DECLARATION
+%type <ast::node_ptr<ast::RoutineDeclaration>> ROUTINE_DECLARATION ROUTINE_HEADER
 %type <ast::node_ptr<ast::Expression>> EXPRESSION
 %type <std::vector<ast::node_ptr<ast::Expression>>> EXPRESSIONS NON_EMPTY_EXPRESSIONS
-%type <ast::node_ptr<ast::Type>> TYPE PRIMITIVE_TYPE ARRAY_TYPE RECORD_TYPE
+%type <ast::node_ptr<ast::Type>> TYPE PRIMITIVE_TYPE ARRAY_TYPE RECORD_TYPE RETURN_TYPE
 %type <ast::node_ptr<ast::Body>> BODY
 %type <ast::node_ptr<ast::Identifier>> MODIFIABLE_PRIMARY
 %type <ast::node_ptr<ast::Statement>> STATEMENT
@@ -62,6 +65,7 @@
 %code requires {
     #include <iostream>
     #include <string>
+    #include <string_view>
     #include <vector>
     #include "ast.hpp"
 
@@ -72,6 +76,8 @@
 }
 
 %code top {
+    #include <chrono>
+
     #include "lexer.h"
     #include "shell.hpp"
 
@@ -79,79 +85,101 @@
     #define GREEN   "\033[32m"
     #define PDEBUG(X) if (shell.debug) std::cout << GREEN << "(" << X << ") " << RESET;
 
+    // A token is too short to time as a stage: its steady_clock time is summed into
+    // shell.lexing_ms, which parse_program charges to "lexing" once.
     static cplus::Parser::symbol_type yylex(cplus::Lexer &lexer, cplus::Shell &shell) {
-        return lexer.get_next_token();
+        if (!shell.report.enabled) {
+            return lexer.get_next_token();
+        }
+        auto start = std::chrono::steady_clock::now();
+        auto token = lexer.get_next_token();
+        shell.lexing_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return token;
     }
-    
-    ast::node_ptr<ast::Program> program = std::make_shared<ast::Program>();  // Points to the whole program node.
 }
 
 
 %%
 
 PROGRAM :
-    %empty {
+    DECLARATIONS {
+        // Resolve calls to routines that were declared after the call site.
+        for (auto call : program.unresolved_calls) {
+            auto it = program.routine_index.find(call->name);
+            if (it == program.routine_index.end()) {
+                error("Routine " + program.symbols.name(call->name) + " is not declared");
+                YYABORT;
+            }
+            call->routine = it->second;
+        }
+        program.unresolved_calls.clear();
+
         PDEBUG("EOF")
-        std::cout << '\n' << std::endl;
+        if (shell.debug) std::cout << '\n' << std::endl;
     }
-    | VARIABLE_DECLARATION PROGRAM {
-        program->variables.push_back($1);
+;
+
+// Lists are left-recursive: elements are appended in source order and the parser stack stays flat.
+DECLARATIONS :
+    %empty
+    | DECLARATIONS VARIABLE_DECLARATION {
+        program.variables.push_back($2);
     }
-    | ROUTINE_DECLARATION PROGRAM
-    | GLOBAL_TYPE_DECLARATION PROGRAM
+    | DECLARATIONS ROUTINE_DECLARATION
+    | DECLARATIONS GLOBAL_TYPE_DECLARATION
 ;
 
 VARIABLE_DECLARATION :
     VAR ID IS EXPRESSION SEMICOLON {
         PDEBUG("VARIABLE_DECLARATION_W/O_TYPE")
-        $$ = std::make_shared<ast::VariableDeclaration> ($2, $4);
+        $$ = program.arena.make<ast::VariableDeclaration> ($2, $4);
     }
     | VAR ID COLON TYPE SEMICOLON {
         PDEBUG("VARIABLE_DECLARATION_W/O_IV")
-        $$ = std::make_shared<ast::VariableDeclaration> ($2, $4);
+        $$ = program.arena.make<ast::VariableDeclaration> ($2, $4);
     }
     | VAR ID COLON TYPE IS EXPRESSION SEMICOLON {
         PDEBUG("VARIABLE_DECLARATION")
-        $$ = std::make_shared<ast::VariableDeclaration> ($2, $4, $6);
+        $$ = program.arena.make<ast::VariableDeclaration> ($2, $4, $6);
     }
 ;
 
 GLOBAL_TYPE_DECLARATION :
     TYPE_KW ID IS TYPE SEMICOLON {
         PDEBUG("GLOBAL_TYPE_DECLARATION")
-        program->types[$2] = $4;
+        program.types[$2] = $4;
     }
 ;
 
 MODIFIABLE_PRIMARY :
-    ID                                { $$ = std::make_shared<ast::Identifier>($1); }
-    | ID SB_L EXPRESSION SB_R         { $$ = std::make_shared<ast::Identifier>($1, $3); }
+    ID                                { $$ = program.arena.make<ast::Identifier>($1); }
+    | ID SB_L EXPRESSION SB_R         { $$ = program.arena.make<ast::Identifier>($1, $3); }
 ;
 
 EXPRESSION :
-    INT_VAL                           { $$ = std::make_shared<ast::IntLiteral>($1); }
-    | REAL_VAL                        { $$ = std::make_shared<ast::RealLiteral>($1); }
-    | BOOL_VAL                        { $$ = std::make_shared<ast::BoolLiteral>($1); }
+    INT_VAL                           { $$ = program.arena.make<ast::IntLiteral>($1); }
+    | REAL_VAL                        { $$ = program.arena.make<ast::RealLiteral>($1); }
+    | BOOL_VAL                        { $$ = program.arena.make<ast::BoolLiteral>($1); }
     | ROUTINE_CALL                    { PDEBUG("ROUTINE_CALL_EXP") $$ = $1; }
     | B_L EXPRESSION B_R              { $$ = $2; }
-    | NOT EXPRESSION                  { $$ = std::make_shared<ast::UnaryExpression>(ast::OperatorEnum::NOT, $2); }
-    | MINUS EXPRESSION                { $$ = std::make_shared<ast::UnaryExpression>(ast::OperatorEnum::MINUS, $2); }
+    | NOT EXPRESSION                  { $$ = program.arena.make<ast::UnaryExpression>(ast::OperatorEnum::NOT, $2); }
+    | MINUS EXPRESSION                { $$ = program.arena.make<ast::UnaryExpression>(ast::OperatorEnum::MINUS, $2); }
     | MODIFIABLE_PRIMARY              { $$ = $1; }
     
-    | EXPRESSION PLUS EXPRESSION      { $$ = std::make_shared<ast::BinaryExpression>($1, ast::OperatorEnum::PLUS, $3); }
-    | EXPRESSION MINUS EXPRESSION     { $$ = std::make_shared<ast::BinaryExpression>($1, ast::OperatorEnum::MINUS, $3); } 
-    | EXPRESSION MUL EXPRESSION       { $$ = std::make_shared<ast::BinaryExpression>($1, ast::OperatorEnum::MUL, $3); } 
-    | EXPRESSION DIV EXPRESSION       { $$ = std::make_shared<ast::BinaryExpression>($1, ast::OperatorEnum::DIV, $3); }
-    | EXPRESSION MOD EXPRESSION       { $$ = std::make_shared<ast::BinaryExpression>($1, ast::OperatorEnum::MOD, $3); }
-    | EXPRESSION AND EXPRESSION       { $$ = std::make_shared<ast::BinaryExpression>($1, ast::OperatorEnum::AND, $3); }
-    | EXPRESSION OR EXPRESSION        { $$ = std::make_shared<ast::BinaryExpression>($1, ast::OperatorEnum::OR, $3); }
-    | EXPRESSION XOR EXPRESSION       { $$ = std::make_shared<ast::BinaryExpression>($1, ast::OperatorEnum::XOR, $3); }
-    | EXPRESSION EQ EXPRESSION        { $$ = std::make_shared<ast::BinaryExpression>($1, ast::OperatorEnum::EQ, $3); } 
-    | EXPRESSION NEQ EXPRESSION       { $$ = std::make_shared<ast::BinaryExpression>($1, ast::OperatorEnum::NEQ, $3); } 
-    | EXPRESSION LT EXPRESSION        { $$ = std::make_shared<ast::BinaryExpression>($1, ast::OperatorEnum::LT, $3); } 
-    | EXPRESSION GT EXPRESSION        { $$ = std::make_shared<ast::BinaryExpression>($1, ast::OperatorEnum::GT, $3); } 
-    | EXPRESSION LEQ EXPRESSION       { $$ = std::make_shared<ast::BinaryExpression>($1, ast::OperatorEnum::LEQ, $3); } 
-    | EXPRESSION GEQ EXPRESSION       { $$ = std::make_shared<ast::BinaryExpression>($1, ast::OperatorEnum::GEQ, $3); } 
+    | EXPRESSION PLUS EXPRESSION      { $$ = program.arena.make<ast::BinaryExpression>($1, ast::OperatorEnum::PLUS, $3); }
+    | EXPRESSION MINUS EXPRESSION     { $$ = program.arena.make<ast::BinaryExpression>($1, ast::OperatorEnum::MINUS, $3); } 
+    | EXPRESSION MUL EXPRESSION       { $$ = program.arena.make<ast::BinaryExpression>($1, ast::OperatorEnum::MUL, $3); } 
+    | EXPRESSION DIV EXPRESSION       { $$ = program.arena.make<ast::BinaryExpression>($1, ast::OperatorEnum::DIV, $3); }
+    | EXPRESSION MOD EXPRESSION       { $$ = program.arena.make<ast::BinaryExpression>($1, ast::OperatorEnum::MOD, $3); }
+    | EXPRESSION AND EXPRESSION       { $$ = program.arena.make<ast::BinaryExpression>($1, ast::OperatorEnum::AND, $3); }
+    | EXPRESSION OR EXPRESSION        { $$ = program.arena.make<ast::BinaryExpression>($1, ast::OperatorEnum::OR, $3); }
+    | EXPRESSION XOR EXPRESSION       { $$ = program.arena.make<ast::BinaryExpression>($1, ast::OperatorEnum::XOR, $3); }
+    | EXPRESSION EQ EXPRESSION        { $$ = program.arena.make<ast::BinaryExpression>($1, ast::OperatorEnum::EQ, $3); } 
+    | EXPRESSION NEQ EXPRESSION       { $$ = program.arena.make<ast::BinaryExpression>($1, ast::OperatorEnum::NEQ, $3); } 
+    | EXPRESSION LT EXPRESSION        { $$ = program.arena.make<ast::BinaryExpression>($1, ast::OperatorEnum::LT, $3); } 
+    | EXPRESSION GT EXPRESSION        { $$ = program.arena.make<ast::BinaryExpression>($1, ast::OperatorEnum::GT, $3); } 
+    | EXPRESSION LEQ EXPRESSION       { $$ = program.arena.make<ast::BinaryExpression>($1, ast::OperatorEnum::LEQ, $3); } 
+    | EXPRESSION GEQ EXPRESSION       { $$ = program.arena.make<ast::BinaryExpression>($1, ast::OperatorEnum::GEQ, $3); } 
 ;
 
 TYPE :
@@ -160,27 +188,32 @@ TYPE :
     | RECORD_TYPE
     | ID {
         PDEBUG("ALIASED_TYPE_ACCESS")
-        $$ = program->types[$1];
+        auto it = program.types.find($1);
+        if (it == program.types.end()) {
+            error("Unknown type " + program.symbols.name($1));
+            YYABORT;
+        }
+        $$ = it->second;
     }
 ;
 
 PRIMITIVE_TYPE :
-    INT_KW    { $$ = std::make_shared<ast::IntType>(); }
-    | REAL_KW { $$ = std::make_shared<ast::RealType>(); }
-    | BOOL_KW { $$ = std::make_shared<ast::BoolType>(); }
+    INT_KW    { $$ = program.arena.make<ast::IntType>(); }
+    | REAL_KW { $$ = program.arena.make<ast::RealType>(); }
+    | BOOL_KW { $$ = program.arena.make<ast::BoolType>(); }
 ;
 
 ARRAY_TYPE :
     ARRAY SB_L EXPRESSION SB_R TYPE {
         PDEBUG("ARRAY_TYPE")
-        $$ = std::make_shared<ast::ArrayType>($3, $5);
+        $$ = program.arena.make<ast::ArrayType>($3, $5);
     }
 ;
 
 RECORD_TYPE :
     RECORD CB_L VARIABLE_DECLARATIONS CB_R END {
         PDEBUG("RECORD_TYPE")
-        $$ = std::make_shared<ast::RecordType>($3);
+        $$ = program.arena.make<ast::RecordType>($3);
     }
 ;
 
@@ -188,33 +221,54 @@ VARIABLE_DECLARATIONS :
     VARIABLE_DECLARATION {
         $$ = std::vector<ast::node_ptr<ast::VariableDeclaration>>(1, $1);
     }
-    | VARIABLE_DECLARATION VARIABLE_DECLARATIONS {
-        $2.push_back($1);
-        $$ = $2;
+    | VARIABLE_DECLARATIONS VARIABLE_DECLARATION {
+        $$ = std::move($1);
+        $$.push_back($2);
     }
 ;
 
 ROUTINE_DECLARATION :
-    ROUTINE ID B_L PARAMETERS B_R IS BODY END {
-        PDEBUG("PROCEDURE_DECLARATION")
-        $$ = std::make_shared<ast::RoutineDeclaration>($2, $4, $7);
-        program->routines.push_back($$);
+    ROUTINE_HEADER IS BODY END {
+        PDEBUG("ROUTINE_DECLARATION")
+        $$ = $1;
+        $$->body = $3;
+    }
+    | ROUTINE_HEADER SEMICOLON {
+        PDEBUG("EXTERNAL_ROUTINE_DECLARATION")
+        $$ = $1;
     }
-    | ROUTINE ID B_L PARAMETERS B_R COLON TYPE IS BODY END {
-        PDEBUG("FUNCTION_DECLARATION")
-        $$ = std::make_shared<ast::RoutineDeclaration>($2, $4, $9, $7);
-        program->routines.push_back($$);
+    | INLINE ROUTINE_DECLARATION {
+        PDEBUG("INLINE_ROUTINE_DECLARATION")
+        $$ = $2;
+        $$->inline_hint = true;
     }
 ;
 
+// Declared before its body is parsed, so the body may call it
+ROUTINE_HEADER :
+    ROUTINE ID B_L PARAMETERS B_R RETURN_TYPE {
+        $$ = program.arena.make<ast::RoutineDeclaration>($2, $4, nullptr, $6);
+        if (!program.routine_index.emplace($2, $$).second) {
+            error("Routine " + program.symbols.name($2) + " is already declared");
+            YYABORT;
+        }
+        program.routines.push_back($$);
+    }
+;
+
+RETURN_TYPE :
+    %empty      { $$ = nullptr; }
+    | COLON TYPE { $$ = $2; }
+;
+
 
 NON_EMPTY_PARAMETERS :
     PARAMETER_DECLARATION {
         $$ = std::vector<ast::node_ptr<ast::VariableDeclaration>>(1, $1);
     }
-    | PARAMETER_DECLARATION COMMA NON_EMPTY_PARAMETERS {
-        $3.push_back($1);
-        $$ = $3;
+    | NON_EMPTY_PARAMETERS COMMA PARAMETER_DECLARATION {
+        $$ = std::move($1);
+        $$.push_back($3);
     }
 ;
 
@@ -223,14 +277,14 @@ PARAMETERS :
         $$ = std::vector<ast::node_ptr<ast::VariableDeclaration>>();
     }
     | NON_EMPTY_PARAMETERS {
-        $$ = $1;
+        $$ = std::move($1);
     }
 ;
 
 PARAMETER_DECLARATION :
     ID COLON TYPE {
         PDEBUG("PARAMETER_DECLARATION")
-        $$ = std::make_shared<ast::VariableDeclaration>($1, $3);
+        $$ = program.arena.make<ast::VariableDeclaration>($1, $3);
     }
 ;
 
@@ -238,15 +292,15 @@ BODY :
     %empty {
         std::vector<ast::node_ptr<ast::VariableDeclaration>> tmp1;
         std::vector<ast::node_ptr<ast::Statement>> tmp2;
-        $$ = std::make_shared<ast::Body>(tmp1, tmp2);
+        $$ = program.arena.make<ast::Body>(tmp1, tmp2);
     }
-    | VARIABLE_DECLARATION BODY {
-        $2->variables.push_back($1);
-        $$ = $2;
+    | BODY VARIABLE_DECLARATION {
+        $1->variables.push_back($2);
+        $$ = $1;
     }
-    | STATEMENT BODY {
-        $2->statements.push_back($1);
-        $$ = $2;
+    | BODY STATEMENT {
+        $1->statements.push_back($2);
+        $$ = $1;
     }
 ;
 
@@ -266,97 +320,78 @@ STATEMENT :
 RETURN_STATEMENT :
     RETURN EXPRESSION SEMICOLON {
         PDEBUG("RETURN_EXP_STATEMENT")
-        $$ = std::make_shared<ast::ReturnStatement>($2);
+        $$ = program.arena.make<ast::ReturnStatement>($2);
     }
     | RETURN SEMICOLON {
         PDEBUG("RETURN_STATEMENT")
-        $$ = std::make_shared<ast::ReturnStatement>();
+        $$ = program.arena.make<ast::ReturnStatement>();
     }
 ;
 
 PRINT_STATEMENT :
     PRINT EXPRESSION SEMICOLON {
         PDEBUG("PRINT_EXP_STATEMENT")
-        $$ = std::make_shared<ast::PrintStatement>($2);
+        $$ = program.arena.make<ast::PrintStatement>($2);
     }
     | PRINT STRING SEMICOLON {
         PDEBUG("PRINT_STR_STATEMENT")
-        $2 = $2.substr(1, $2.size()-2);
-        $$ = std::make_shared<ast::PrintStatement>(std::make_shared<std::string>($2));
+        $$ = program.arena.make<ast::PrintStatement>(program.arena.make<std::string>($2.substr(1, $2.size()-2)));
     }
     | PRINTLN EXPRESSION SEMICOLON {
         PDEBUG("PRINTLN_EXP_STATEMENT")
-        $$ = std::make_shared<ast::PrintStatement>($2, true);
+        $$ = program.arena.make<ast::PrintStatement>($2, true);
     }
     | PRINTLN STRING SEMICOLON {
         PDEBUG("PRINTLN_STR_STATEMENT")
-        $2 = $2.substr(1, $2.size()-2);
-        $$ = std::make_shared<ast::PrintStatement>(std::make_shared<std::string>($2), true);
+        $$ = program.arena.make<ast::PrintStatement>(program.arena.make<std::string>($2.substr(1, $2.size()-2)), true);
     }
 ;
 
 ASSIGNMENT_STATEMENT :
     MODIFIABLE_PRIMARY BECOMES EXPRESSION SEMICOLON {
         PDEBUG("ASSIGNMENT_STATEMENT")
-        $$ = std::make_shared<ast::AssignmentStatement>($1, $3);
+        $$ = program.arena.make<ast::AssignmentStatement>($1, $3);
     }
 ;
 
 IF_STATEMENT :
     IF EXPRESSION THEN BODY END {
         PDEBUG("IF_STATEMENT")
-        $$ = std::make_shared<ast::IfStatement>($2, $4);
+        $$ = program.arena.make<ast::IfStatement>($2, $4);
     }
     | IF EXPRESSION THEN BODY ELSE BODY END {
         PDEBUG("IF_ELSE_STATEMENT")
-        $$ = std::make_shared<ast::IfStatement>($2, $4, $6);
+        $$ = program.arena.make<ast::IfStatement>($2, $4, $6);
     }
 ;
 
 WHILE_LOOP :
     WHILE EXPRESSION LOOP BODY END {
         PDEBUG("WHILE_LOOP")
-        $$ = std::make_shared<ast::WhileLoop>($2, $4);
+        $$ = program.arena.make<ast::WhileLoop>($2, $4, $1);
     }
 ;
 
 FOR_LOOP :
     FOR ID IN EXPRESSION DDOT EXPRESSION LOOP BODY END {
         PDEBUG("FOR_LOOP")
-
-        auto loop_var = std::make_shared<ast::VariableDeclaration>($2, $4);
-        auto id = std::make_shared<ast::Identifier>($2);
-        auto one = std::make_shared<ast::IntLiteral>(1);
-        auto idp1 = std::make_shared<ast::BinaryExpression>(id, ast::OperatorEnum::PLUS, one);
-        auto cond = std::make_shared<ast::BinaryExpression>(id, ast::OperatorEnum::LEQ, $6);
-        auto body = $8;
-        auto action = std::make_shared<ast::AssignmentStatement>(id, idp1);
-
-        $$ = std::make_shared<ast::ForLoop>(loop_var, cond, body, action);
+        $$ = program.arena.make<ast::ForLoop>($2, $4, $6, false, $8, $1);
     }
     | FOR ID IN REVERSE EXPRESSION DDOT EXPRESSION LOOP BODY END {
         PDEBUG("FOR_REVERSE_LOOP")
-
-        auto loop_var = std::make_shared<ast::VariableDeclaration>($2, $7);
-        auto id = std::make_shared<ast::Identifier>($2);
-        auto one = std::make_shared<ast::IntLiteral>(1);
-        auto idm1 = std::make_shared<ast::BinaryExpression>(id, ast::OperatorEnum::MINUS, one);
-        auto cond = std::make_shared<ast::BinaryExpression>(id, ast::OperatorEnum::GEQ, $5);
-        auto body = $9;
-        auto action = std::make_shared<ast::AssignmentStatement>(id, idm1);
-
-        $$ = std::make_shared<ast::ForLoop>(loop_var, cond, body, action);
+        $$ = program.arena.make<ast::ForLoop>($2, $5, $7, true, $9, $1);
     }
 ;
 
 ROUTINE_CALL :
     ID B_L EXPRESSIONS B_R {
-        ast::node_ptr<ast::RoutineCall> call;
-        for(auto u : program->routines) {
-            if(u->name == $1) {
-                $$ = std::make_shared<ast::RoutineCall>(u, $3);
-                break;        
-            }
+        $$ = program.arena.make<ast::RoutineCall>($1, std::move($3));
+        auto it = program.routine_index.find($1);
+        if (it != program.routine_index.end()) {
+            $$->routine = it->second;
+        }
+        else {
+            program.unresolved_calls.push_back($$);  // forward reference or recursion
         }
     }
 ; 
@@ -365,9 +400,9 @@ NON_EMPTY_EXPRESSIONS :
     EXPRESSION {
         $$ = std::vector<ast::node_ptr<ast::Expression>>(1, $1);
     }
-    | EXPRESSION COMMA NON_EMPTY_EXPRESSIONS {
-        $3.push_back($1);
-        $$ = $3;
+    | NON_EMPTY_EXPRESSIONS COMMA EXPRESSION {
+        $$ = std::move($1);
+        $$.push_back($3);
     }
 ;
 
@@ -377,7 +412,7 @@ EXPRESSIONS :
         $$ = std::vector<ast::node_ptr<ast::Expression>>();
     }
     | NON_EMPTY_EXPRESSIONS {
-        $$ = $1;
+        $$ = std::move($1);
     }
 ;
 
@@ -0,0 +1,136 @@
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "report.hpp"
+
+namespace cplus {
+
+static double wall_ms() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration<double, std::milli>(now).count();
+}
+
+// A compilation runs on a single thread, so only that thread's CPU time is charged to it.
+static double cpu_ms() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static long peak_rss_kb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+// Charges the time since the last transition to the innermost active stage.
+void TimeReport::charge() {
+    double wall = wall_ms(), cpu = cpu_ms();
+    if (!active.empty()) {
+        stages[active.back()].wall_ms += wall - last_wall_ms;
+        stages[active.back()].cpu_ms += cpu - last_cpu_ms;
+    }
+    last_wall_ms = wall;
+    last_cpu_ms = cpu;
+}
+
+// Returns the index of a stage, adding it on first use.
+size_t TimeReport::find(const char *stage) {
+    size_t idx = 0;
+    while (idx < stages.size() && stages[idx].name != stage && std::strcmp(stages[idx].name, stage)) {
+        idx++;
+    }
+    if (idx == stages.size()) {
+        stages.push_back({stage});
+    }
+    return idx;
+}
+
+void TimeReport::push(const char *stage) {
+    charge();
+    active.push_back(find(stage));
+}
+
+// Peak memory is read once, when the outermost stage closes, and charged to it and every stage inside it.
+void TimeReport::pop() {
+    charge();
+
+    closed.push_back(active.back());
+    active.pop_back();
+    if (active.empty()) {
+        long rss = peak_rss_kb();
+        for (auto idx : closed) {
+            stages[idx].peak_rss_kb = std::max(stages[idx].peak_rss_kb, rss);
+        }
+        closed.clear();
+    }
+}
+
+// Charges time measured by the caller (summed over pieces too short for a Scope) to an inner stage,
+// out of the innermost active one. The pieces are CPU-bound, so their wall time counts as CPU time too.
+void TimeReport::charge_inner(const char *stage, double ms) {
+    if (!enabled || active.empty()) {
+        return;
+    }
+    charge();
+    size_t idx = find(stage);
+    auto &outer = stages[active.back()];
+    ms = std::min({ms, outer.wall_ms, outer.cpu_ms});
+    outer.wall_ms -= ms;
+    outer.cpu_ms -= ms;
+    stages[idx].wall_ms += ms;
+    stages[idx].cpu_ms += ms;
+    closed.push_back(idx);
+}
+
+// Adds the CPU time and memory of stages that ran on another thread (a codegen partition).
+// Their wall time is not added: it already elapsed inside this report's active stage.
+void TimeReport::merge(const TimeReport &other) {
+    for (auto& theirs : other.stages) {
+        auto &ours = stages[find(theirs.name)];
+        ours.cpu_ms += theirs.cpu_ms;
+        ours.peak_rss_kb = std::max(ours.peak_rss_kb, theirs.peak_rss_kb);
+    }
+}
+
+void TimeReport::print(std::ostream &out) const {
+    double total_wall = 0, total_cpu = 0;
+    long total_rss = 0;
+    for (auto& stage : stages) {
+        total_wall += stage.wall_ms;
+        total_cpu += stage.cpu_ms;
+        total_rss = std::max(total_rss, stage.peak_rss_kb);
+    }
+
+    auto flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+
+    if (json) {
+        out << "{\"stages\": [";
+        for (size_t i = 0; i < stages.size(); i++) {
+            out << (i ? ", " : "") << "{\"name\": \"" << stages[i].name << "\", \"wall_ms\": " << stages[i].wall_ms
+                << ", \"cpu_ms\": " << stages[i].cpu_ms << ", \"peak_rss_kb\": " << stages[i].peak_rss_kb << "}";
+        }
+        out << "], \"total\": {\"wall_ms\": " << total_wall << ", \"cpu_ms\": " << total_cpu
+            << ", \"peak_rss_kb\": " << total_rss << "}}" << std::endl;
+    }
+    else {
+        out << "[TIME REPORT]:\n";
+        out << std::left << std::setw(16) << "stage" << std::right << std::setw(12) << "wall (ms)"
+            << std::setw(12) << "cpu (ms)" << std::setw(18) << "peak rss (KiB)" << '\n';
+        for (auto& stage : stages) {
+            out << std::left << std::setw(16) << stage.name << std::right << std::setw(12) << stage.wall_ms
+                << std::setw(12) << stage.cpu_ms << std::setw(18) << stage.peak_rss_kb << '\n';
+        }
+        out << std::left << std::setw(16) << "total" << std::right << std::setw(12) << total_wall
+            << std::setw(12) << total_cpu << std::setw(18) << total_rss << std::endl;
+    }
+
+    out.flags(flags);
+}
+
+} // namespace cplus
@@ -0,0 +1,62 @@
+#ifndef REPORT_H
+#define REPORT_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace cplus {
+
+// Wall time, CPU time and peak memory of each compiler stage, printed by --time-report.
+// Stages nest: time spent in an inner stage (lexing inside parsing) is charged to the inner one only.
+class TimeReport {
+public:
+    // Charges its lifetime to a stage. Does nothing while the report is disabled.
+    class Scope {
+    public:
+        Scope(TimeReport &report, const char *stage) : report(report.enabled ? &report : nullptr) {
+            if (this->report) {
+                this->report->push(stage);
+            }
+        }
+        ~Scope() {
+            if (report) {
+                report->pop();
+            }
+        }
+        Scope(const Scope&) = delete;
+        Scope &operator=(const Scope&) = delete;
+
+    private:
+        TimeReport *report;
+    };
+
+    bool enabled = false;
+    bool json = false;
+
+    Scope time(const char *stage) { return Scope(*this, stage); }
+    void charge_inner(const char *stage, double ms);
+    void merge(const TimeReport &other);
+    void print(std::ostream &out) const;
+
+private:
+    struct Stage {
+        const char *name;
+        double wall_ms = 0, cpu_ms = 0;
+        long peak_rss_kb = 0;
+    };
+
+    std::vector<Stage> stages;  // in order of first use
+    std::vector<size_t> active; // indices into stages, innermost last
+    std::vector<size_t> closed; // stages closed since the outermost active one opened
+    double last_wall_ms = 0, last_cpu_ms = 0;
+
+    size_t find(const char *stage);
+    void push(const char *stage);
+    void pop();
+    void charge();
+};
+
+} // namespace cplus
+
+#endif // REPORT_H
@@ -0,0 +1,147 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "runtime.h"
+
+#define BUFFER_SIZE (64 * 1024)
+#define MAX_F64_LEN 330 // "%f" of -DBL_MAX
+
+int cplus_line_buffered = -1;
+
+static char buffer[BUFFER_SIZE];
+static size_t used;
+static int initialized;
+
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static void write_all(const char *data, size_t len) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = write(STDOUT_FILENO, data + done, len - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += n;
+    }
+}
+
+void cplus_flush(void) {
+    write_all(buffer, used);
+    used = 0;
+}
+
+// Returns room for at least len bytes (len <= BUFFER_SIZE), flushing if needed.
+static char *reserve(size_t len) {
+    if (!initialized) {
+        initialized = 1;
+        if (cplus_line_buffered < 0) {
+            cplus_line_buffered = isatty(STDOUT_FILENO);
+        }
+        atexit(cplus_flush);
+    }
+    if (used + len > BUFFER_SIZE) {
+        cplus_flush();
+    }
+    return buffer + used;
+}
+
+static void end_write(size_t len, int newline) {
+    used += len;
+    if (newline) {
+        buffer[used++] = '\n';
+        if (cplus_line_buffered) {
+            cplus_flush();
+        }
+    }
+}
+
+// Writes the decimal digits of value ending right before end, two at a time; returns the first one.
+static char *format_u64(uint64_t value, char *end) {
+    while (value >= 100) {
+        unsigned pair = (value % 100) * 2;
+        value /= 100;
+        *--end = digit_pairs[pair + 1];
+        *--end = digit_pairs[pair];
+    }
+    if (value >= 10) {
+        *--end = digit_pairs[value * 2 + 1];
+        *--end = digit_pairs[value * 2];
+    }
+    else {
+        *--end = '0' + value;
+    }
+    return end;
+}
+
+void cplus_write_i64(int64_t value, int newline) {
+    char *out = reserve(21);
+    char digits[20], *end = digits + sizeof digits;
+    char *first = format_u64(value < 0 ? 0 - (uint64_t)value : (uint64_t)value, end);
+    size_t len = 0;
+    if (value < 0) {
+        out[len++] = '-';
+    }
+    memcpy(out + len, first, end - first);
+    end_write(len + (end - first), newline);
+}
+
+// Integer part and six rounded decimals, as printf("%f") would print them. The scaled fraction
+// is within 2^-33 of its exact value, so the rounding direction is only in doubt near a tie,
+// where (like for huge and non-finite values) printf itself is used.
+void cplus_write_f64(double value, int newline) {
+    char *out = reserve(MAX_F64_LEN + 1);
+    double mag = fabs(value);
+    if (mag < 9007199254740992.0) { // 2^53
+        double ipart = floor(mag);
+        double scaled = (mag - ipart) * 1e6;
+        double fpart = floor(scaled);
+        if (fabs(scaled - fpart - 0.5) > 1e-6) {
+            uint64_t i = (uint64_t)ipart, f = (uint64_t)fpart + (scaled - fpart > 0.5);
+            if (f == 1000000) {
+                f = 0;
+                i++;
+            }
+            char digits[28], *end = digits + sizeof digits;
+            for (int n = 0; n < 6; n++, f /= 10) {
+                *--end = '0' + f % 10;
+            }
+            *--end = '.';
+            char *first = format_u64(i, end);
+            if (signbit(value)) {
+                *--first = '-';
+            }
+            memcpy(out, first, end + 7 - first);
+            end_write(end + 7 - first, newline);
+            return;
+        }
+    }
+    end_write(snprintf(out, MAX_F64_LEN + 1, "%f", value), newline);
+}
+
+void cplus_write_str(const char *str, int64_t len, int newline) {
+    if (len >= BUFFER_SIZE) {
+        reserve(0);
+        cplus_flush();
+        write_all(str, len);
+        end_write(0, newline);
+        return;
+    }
+    memcpy(reserve(len + 1), str, len);
+    end_write(len, newline);
+}
+
+void cplus_bounds_error(int64_t index, int64_t size) {
+    cplus_flush();
+    fprintf(stderr, "Error: index %lld is out of bounds for an array of size %lld\n", (long long)index, (long long)size);
+    exit(1);
+}
@@ -0,0 +1,26 @@
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Output routines called by compiled programs (libcplus_rt.a). Output is collected in a buffer
+// that is written when full and at exit, and also at every newline when cplus_line_buffered is set.
+extern int cplus_line_buffered; // -1 (default): set on first write if stdout is a terminal
+
+void cplus_write_i64(int64_t value, int newline);
+void cplus_write_f64(double value, int newline);   // formats like printf("%f")
+void cplus_write_str(const char *str, int64_t len, int newline);
+void cplus_flush(void);
+
+// Reports an array index outside 1..size (--bounds-check) and exits.
+void cplus_bounds_error(int64_t index, int64_t size) __attribute__((noreturn));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RUNTIME_H
@@ -0,0 +1,320 @@
+#include "semantic.hpp"
+
+using ast::TypeEnum;
+
+// The shared instance of a primitive type; other types are returned as they are.
+static ast::Type *canonical(ast::Type *type) {
+    if (!type) {
+        return nullptr;
+    }
+    switch (type->getType()) {
+        case TypeEnum::INT:  return ast::int_type();
+        case TypeEnum::REAL: return ast::real_type();
+        case TypeEnum::BOOL: return ast::bool_type();
+        default:             return type;
+    }
+}
+
+static bool is_primitive(ast::Type *type) {
+    return type && (type->getType() == TypeEnum::INT || type->getType() == TypeEnum::REAL || type->getType() == TypeEnum::BOOL);
+}
+
+void SemanticAnalyzer::declare(ast::Symbol sym, ast::Type *type) {
+    auto it = types.find(sym);
+    saved.emplace_back(sym, it == types.end() ? nullptr : it->second);
+    types[sym] = canonical(type);
+}
+
+// Record fields are variables named "<record>.<field>".
+void SemanticAnalyzer::declare_fields(ast::RecordType *rt, const std::string &prefix) {
+    for (auto& field : rt->fields) {
+        std::string field_name = prefix + "." + name(field->name);
+        ast::Symbol sym = program.symbols.find(field_name);
+        if (sym != ast::NO_SYMBOL) {
+            declare(sym, field->dtype);
+        }
+        if (field->dtype && field->dtype->getType() == TypeEnum::RECORD) {
+            declare_fields(static_cast<ast::RecordType*>(field->dtype), field_name);
+        }
+    }
+}
+
+void SemanticAnalyzer::pop(size_t mark) {
+    while (saved.size() > mark) {
+        auto& [sym, type] = saved.back();
+        if (type) {
+            types[sym] = type;
+        }
+        else {
+            types.erase(sym);
+        }
+        saved.pop_back();
+    }
+}
+
+// Type of an analyzed expression, which must have an integer, real or boolean value.
+ast::Type *SemanticAnalyzer::primitive(ast::Expression *exp, const char *what) {
+    if (!exp->dtype) {
+        throw SemanticError(std::string(what) + " has no value: it calls a procedure");
+    }
+    if (!is_primitive(exp->dtype)) {
+        throw SemanticError(std::string(what) + " is not an integer, real or boolean");
+    }
+    return exp->dtype;
+}
+
+// Wraps an analyzed expression into a Cast to type, unless it already has that type.
+void SemanticAnalyzer::convert(ast::node_ptr<ast::Expression> &exp, ast::Type *type, const char *what) {
+    auto from = primitive(exp, what);
+    if (!is_primitive(type)) {
+        throw SemanticError(std::string(what) + " cannot be converted to a non-primitive type");
+    }
+    if (from->getType() != type->getType()) {
+        exp = program.arena.make<ast::Cast>(exp, canonical(type));
+    }
+}
+
+void SemanticAnalyzer::visit(ast::Program *program) {
+    for (auto& var : program->variables) {
+        var->accept(this);
+    }
+    for (auto& routine : program->routines) {
+        routine->accept(this);
+    }
+}
+
+void SemanticAnalyzer::visit(ast::IntType *it) {}
+void SemanticAnalyzer::visit(ast::RealType *rt) {}
+void SemanticAnalyzer::visit(ast::BoolType *bt) {}
+
+void SemanticAnalyzer::visit(ast::ArrayType *at) {
+    at->size->accept(this);
+    convert(at->size, ast::int_type(), "An array size");
+    at->dtype->accept(this);
+}
+
+void SemanticAnalyzer::visit(ast::RecordType *rt) {
+    for (auto& field : rt->fields) {
+        analyze_declaration(field);
+    }
+}
+
+void SemanticAnalyzer::visit(ast::IntLiteral *il) {}
+void SemanticAnalyzer::visit(ast::RealLiteral *rl) {}
+void SemanticAnalyzer::visit(ast::BoolLiteral *bl) {}
+
+// Analyzes the type and initializer of a declaration, without declaring it.
+void SemanticAnalyzer::analyze_declaration(ast::VariableDeclaration *var) {
+    if (var->dtype) {
+        var->dtype->accept(this);
+    }
+    if (!var->initial_value) {
+        return;
+    }
+    var->initial_value->accept(this);
+    if (var->dtype) {
+        convert(var->initial_value, var->dtype, "An initializer");
+    }
+    else {
+        var->dtype = primitive(var->initial_value, "An initializer");
+    }
+}
+
+// The initializer is analyzed first, so it still sees an outer variable of the same name.
+void SemanticAnalyzer::visit(ast::VariableDeclaration *var) {
+    analyze_declaration(var);
+
+    declare(var->name, var->dtype);
+    if (var->dtype->getType() == TypeEnum::RECORD) {
+        declare_fields(static_cast<ast::RecordType*>(var->dtype), name(var->name));
+    }
+}
+
+void SemanticAnalyzer::visit(ast::Identifier *id) {
+    auto it = types.find(id->name);
+    if (it == types.end()) {
+        throw SemanticError(name(id->name) + " is not declared.");
+    }
+    ast::Type *type = it->second;
+
+    if (id->idx) {
+        if (type->getType() != TypeEnum::ARRAY) {
+            throw SemanticError(name(id->name) + " is not an array");
+        }
+        id->idx->accept(this);
+        convert(id->idx, ast::int_type(), "An array index");
+        type = canonical(static_cast<ast::ArrayType*>(type)->dtype);
+    }
+    else if (type->getType() == TypeEnum::ARRAY) {
+        throw SemanticError("Array " + name(id->name) + " is used without an index");
+    }
+    id->dtype = type;
+}
+
+void SemanticAnalyzer::visit(ast::Cast *cast) {
+    cast->operand->accept(this);
+}
+
+void SemanticAnalyzer::visit(ast::UnaryExpression *exp) {
+    exp->operand->accept(this);
+    auto type = primitive(exp->operand, "An operand");
+
+    switch (exp->op) {
+        case ast::OperatorEnum::MINUS:
+            exp->dtype = type->getType() == TypeEnum::REAL ? type : ast::int_type();
+            break;
+
+        default: // NOT
+            exp->dtype = ast::bool_type();
+            break;
+    }
+    convert(exp->operand, exp->dtype, "An operand");
+}
+
+void SemanticAnalyzer::visit(ast::BinaryExpression *exp) {
+    exp->lhs->accept(this);
+    exp->rhs->accept(this);
+    auto L = primitive(exp->lhs, "An operand")->getType();
+    auto R = primitive(exp->rhs, "An operand")->getType();
+    bool real = L == TypeEnum::REAL || R == TypeEnum::REAL;
+
+    ast::Type *operands;
+    switch (exp->op) {
+        case ast::OperatorEnum::PLUS:
+        case ast::OperatorEnum::MINUS:
+        case ast::OperatorEnum::MUL:
+        case ast::OperatorEnum::DIV:
+            operands = exp->dtype = real ? ast::real_type() : ast::int_type();
+            break;
+
+        case ast::OperatorEnum::MOD:
+            if (real) {
+                throw SemanticError("The operands of mod must be integers");
+            }
+            operands = exp->dtype = ast::int_type();
+            break;
+
+        // Bitwise on two integers
+        case ast::OperatorEnum::AND:
+        case ast::OperatorEnum::OR:
+        case ast::OperatorEnum::XOR:
+            operands = exp->dtype = L == TypeEnum::INT && R == TypeEnum::INT ? ast::int_type() : ast::bool_type();
+            break;
+
+        default: // comparisons
+            if (real) {
+                operands = ast::real_type();
+            }
+            else if (L == TypeEnum::BOOL && R == TypeEnum::BOOL) {
+                operands = ast::bool_type();
+            }
+            else {
+                operands = ast::int_type();
+            }
+            exp->dtype = ast::bool_type();
+            break;
+    }
+    convert(exp->lhs, operands, "An operand");
+    convert(exp->rhs, operands, "An operand");
+}
+
+void SemanticAnalyzer::visit(ast::RoutineDeclaration *routine) {
+    size_t mark = saved.size();
+    for (auto& param : routine->params) {
+        declare(param->name, param->dtype);
+    }
+    this->routine = routine;
+
+    if (routine->body) {
+        routine->body->accept(this);
+    }
+
+    this->routine = nullptr;
+    pop(mark);
+}
+
+void SemanticAnalyzer::visit(ast::Body *body) {
+    size_t mark = saved.size();
+    for (auto& var : body->variables) {
+        var->accept(this);
+    }
+    for (auto& stmt : body->statements) {
+        stmt->accept(this);
+    }
+    pop(mark);
+}
+
+void SemanticAnalyzer::visit(ast::ReturnStatement *stmt) {
+    if (!stmt->exp) {
+        if (routine->rtype) {
+            throw SemanticError("Routine " + name(routine->name) + " must return a value");
+        }
+        return;
+    }
+    if (!routine->rtype) {
+        throw SemanticError("Routine " + name(routine->name) + " has no return type but returns a value");
+    }
+    stmt->exp->accept(this);
+    convert(stmt->exp, routine->rtype, "A return value");
+}
+
+void SemanticAnalyzer::visit(ast::PrintStatement *stmt) {
+    if (stmt->exp) {
+        stmt->exp->accept(this);
+        primitive(stmt->exp, "A printed value");
+    }
+}
+
+void SemanticAnalyzer::visit(ast::AssignmentStatement *stmt) {
+    stmt->id->accept(this);
+    stmt->exp->accept(this);
+    convert(stmt->exp, primitive(stmt->id, "An assignment target"), "An assigned value");
+}
+
+void SemanticAnalyzer::visit(ast::IfStatement *stmt) {
+    stmt->cond->accept(this);
+    convert(stmt->cond, ast::bool_type(), "A condition");
+    stmt->then_body->accept(this);
+    if (stmt->else_body) {
+        stmt->else_body->accept(this);
+    }
+}
+
+void SemanticAnalyzer::visit(ast::WhileLoop *stmt) {
+    stmt->cond->accept(this);
+    convert(stmt->cond, ast::bool_type(), "A condition");
+    stmt->body->accept(this);
+}
+
+// The counter takes the type of its first value (from, or to in a reverse loop), the last value
+// is converted to it. Booleans count as integers.
+void SemanticAnalyzer::visit(ast::ForLoop *stmt) {
+    stmt->from->accept(this);
+    stmt->to->accept(this);
+    auto first = primitive(stmt->reverse ? stmt->to : stmt->from, "A loop bound");
+    auto type = first->getType() == TypeEnum::REAL ? ast::real_type() : ast::int_type();
+    convert(stmt->from, type, "A loop bound");
+    convert(stmt->to, type, "A loop bound");
+
+    size_t mark = saved.size();
+    declare(stmt->loop_var, type);
+    stmt->body->accept(this);
+    pop(mark);
+}
+
+void SemanticAnalyzer::visit(ast::RoutineCall *stmt) {
+    auto routine = stmt->routine;
+    if (!routine) {
+        throw SemanticError("Routine " + name(stmt->name) + " is not declared");
+    }
+    if (routine->params.size() != stmt->args.size()) {
+        throw SemanticError("Arity mismatch calling " + name(stmt->name) + ". Expected: " +
+                            std::to_string(routine->params.size()) + ". Got: " + std::to_string(stmt->args.size()));
+    }
+
+    for (size_t i = 0; i < stmt->args.size(); i++) {
+        stmt->args[i]->accept(this);
+        convert(stmt->args[i], routine->params[i]->dtype, "An argument");
+    }
+    stmt->dtype = canonical(routine->rtype);
+}
@@ -0,0 +1,67 @@
+#ifndef SEMANTIC_H
+#define SEMANTIC_H
+
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ast.hpp"
+
+struct SemanticError : std::runtime_error {
+    using std::runtime_error::runtime_error;
+};
+
+// Resolves the type of every expression into Expression::dtype and makes every implicit
+// conversion an explicit ast::Cast, so later passes and codegen never have to work types out:
+//   - arithmetic on a real is real, other arithmetic is integer; comparisons of a real compare
+//     reals, of two booleans booleans, and otherwise integers;
+//   - and, or and xor are bitwise on two integers and take booleans otherwise, as do not and conditions;
+//   - initializers, assigned values, arguments, return values, indices and array sizes are
+//     converted to the type they are stored as; a for loop counter has the type of its first value.
+// Declarations without a type get the type of their initializer. Runs right after parsing.
+class SemanticAnalyzer : public Visitor {
+public:
+    SemanticAnalyzer(ast::Program &program) : program(program) {}
+
+    void visit(ast::Program *program) override;
+    void visit(ast::IntType *it) override;
+    void visit(ast::RealType *rt) override;
+    void visit(ast::BoolType *bt) override;
+    void visit(ast::ArrayType *at) override;
+    void visit(ast::RecordType *rt) override;
+    void visit(ast::IntLiteral *il) override;
+    void visit(ast::RealLiteral *rl) override;
+    void visit(ast::BoolLiteral *bl) override;
+    void visit(ast::VariableDeclaration *var) override;
+    void visit(ast::Identifier *id) override;
+    void visit(ast::Cast *cast) override;
+    void visit(ast::UnaryExpression *exp) override;
+    void visit(ast::BinaryExpression *exp) override;
+    void visit(ast::RoutineDeclaration *routine) override;
+    void visit(ast::Body *body) override;
+    void visit(ast::ReturnStatement *stmt) override;
+    void visit(ast::PrintStatement *stmt) override;
+    void visit(ast::AssignmentStatement *stmt) override;
+    void visit(ast::IfStatement *stmt) override;
+    void visit(ast::WhileLoop *stmt) override;
+    void visit(ast::ForLoop *stmt) override;
+    void visit(ast::RoutineCall *stmt) override;
+
+private:
+    ast::Program &program;
+    std::unordered_map<ast::Symbol, ast::Type*> types;         // of the innermost variable of each name
+    std::vector<std::pair<ast::Symbol, ast::Type*>> saved;     // what each declaration hid, innermost last
+    ast::RoutineDeclaration *routine = nullptr;                // being analyzed
+
+    void declare(ast::Symbol sym, ast::Type *type);
+    void declare_fields(ast::RecordType *rt, const std::string &prefix);
+    void pop(size_t mark);
+    void analyze_declaration(ast::VariableDeclaration *var);
+    void convert(ast::node_ptr<ast::Expression> &exp, ast::Type *type, const char *what);
+    ast::Type *primitive(ast::Expression *exp, const char *what);
+    const std::string &name(ast::Symbol sym) { return program.symbols.name(sym); }
+};
+
+#endif // SEMANTIC_H
@@ -1,31 +1,128 @@
 #include "shell.hpp"
 
-extern ast::node_ptr<ast::Program> program;
-cplus::Shell shell;
+#include <algorithm>
+#include <limits>
+
+#include <llvm/ADT/StringExtras.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/ProfileData/InstrProfReader.h>
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Host.h>
+#include <llvm/Support/Path.h>
 
 namespace cplus {
 
-Shell::Shell() : lexer(*this), parser(lexer, *this) {}
+Shell::Shell(const Options &options, const std::string &infile)
+    : Options(options), infile(infile), program(std::make_unique<ast::Program>()),
+      lexer(*this), parser(lexer, *this, *program) {
+    report.enabled = time_report;
+    report.json = time_report_json;
+
+    // Objects, assembly and IR are named after their source file (dir/foo.cp -> dir/foo.o), and
+    // so are the executables of batch compiles (dir/foo.cp -> dir/foo).
+    static const char *extensions[] = {"", ".o", ".s", ".bc", ".ll"};
+    if (outfile.empty() && (options.infiles.size() > 1 || emit != Emit::EXECUTABLE)) {
+        llvm::SmallString<128> path(infile);
+        llvm::sys::path::replace_extension(path, extensions[static_cast<int>(emit)]);
+        outfile = path == infile ? infile + ".out" : std::string(path.str());
+    }
+    else if (outfile.empty()) {
+        outfile = "a.out";
+    }
+}
+
+// Maps the source file and points the lexer at it.
+int Shell::open() {
+    auto buffer = llvm::MemoryBuffer::getFile(infile);
+    if (!buffer) {
+        std::cerr << "Error: no such file: " << infile << '\n';
+        return 1;
+    }
+    source = std::move(*buffer);
+    readFrom(*source);
+    return 0;
+}
 
 int Shell::parse_program() {
-    return parser.parse();
+    int status = parser.parse();
+    report.charge_inner("lexing", lexing_ms);
+    return status;
+}
+
+void Shell::readFrom(const llvm::MemoryBuffer &buffer) {
+    lexer.set_input(buffer.getBufferStart(), buffer.getBufferEnd());
 }
 
-void Shell::readFrom(std::istream *is) {
-    lexer.switch_streams(is, nullptr);
+unsigned Shell::line(size_t offset) const {
+    llvm::StringRef text = source->getBuffer();
+    return 1 + text.take_front(offset).count('\n');
 }
 
-void Shell::show_help() {
-    std::cout << "usage: cplus [options] infile\n";
-    std::cout << "\tinfile\t\t\tpath to the source code file (*.cp) to compile.\n\n";
+void Options::show_help() {
+    std::cout << "usage: cplus [options] infile...\n";
+    std::cout << "       cplus [options] --serve\n";
+    std::cout << "\tinfile\t\t\tpath to the source code file (*.cp) to compile. Several infiles are\n";
+    std::cout << "\t\t\t\tcompiled in parallel, each into an executable named after it. Given\n";
+    std::cout << "\t\t\t\t-o, or object files (*.o, *.a) or LLVM modules (*.bc, *.ll) among them,\n";
+    std::cout << "\t\t\t\tall infiles are linked into one executable instead.\n\n";
     std::cout << "options:\n";
     std::cout << "\t-h, --help\t\tshow this help message and exit.\n";
     std::cout << "\t-d, --debug\t\tshow debug messages.\n";
-    std::cout << "\t-o, --outfile outfile\texecutable file name.\n";
+    std::cout << "\t-o, --outfile outfile\toutput file name.\n";
+    std::cout << "\t-c, -emit-obj\t\twrite an object file (foo.o for foo.cp) instead of an executable.\n";
+    std::cout << "\t-S\t\t\twrite assembly (foo.s), or textual LLVM IR (foo.ll) with -emit-llvm.\n";
+    std::cout << "\t-emit-llvm-bc\t\twrite LLVM bitcode (foo.bc); also -c -emit-llvm.\n";
+    std::cout << "\t-O0, -O1, -O2, -O3\toptimization level (default: -O0).\n";
+    std::cout << "\t-march=native\t\tgenerate code for the host CPU and all of its features.\n";
+    std::cout << "\t-mcpu=cpu, -march=cpu\tgenerate code for a CPU, e.g. haswell or znver3 (default: generic).\n";
+    std::cout << "\t-mattr=+f1,-f2\t\tenable or disable target features, e.g. +avx2,+fma.\n";
+    std::cout << "\t-j, --jobs n\t\tcompile up to n infiles at once (default: one per hardware thread).\n";
+    std::cout << "\t--partitions n\t\tsplit the routines of a program into n modules that are lowered,\n";
+    std::cout << "\t\t\t\toptimized and emitted on parallel threads (default: 1). Calls between\n";
+    std::cout << "\t\t\t\tpartitions are not inlined.\n";
+    std::cout << "\t--always-inline\t\tinline every call to an \"inline routine\", even at -O0.\n";
+    std::cout << "\t--inline-threshold=n\tcost up to which the inliner inlines a call (default: set by -O).\n";
+    std::cout << "\t--profile-generate[=file]\n";
+    std::cout << "\t\t\t\tinstrument the program to write an execution profile to file when it\n";
+    std::cout << "\t\t\t\texits (default: default_%m.profraw, %m a hash of the program;\n";
+    std::cout << "\t\t\t\t$LLVM_PROFILE_FILE overrides it). Linking needs the clang of the\n";
+    std::cout << "\t\t\t\tLLVM cplus is built with.\n";
+    std::cout << "\t--profile-use=file\toptimize with a profile merged by \"llvm-profdata merge -o file\":\n";
+    std::cout << "\t\t\t\tbranch weights, inlining and block layout follow it. Use the same\n";
+    std::cout << "\t\t\t\toptions as when generating it.\n";
+    std::cout << "\t-r, --run\t\tJIT-compile and run the program instead of writing an executable.\n";
+    std::cout << "\t--bounds-check\t\tstop with an error when an array index is out of bounds. Accesses\n";
+    std::cout << "\t\t\t\tthat provably stay in bounds are not checked.\n";
+    std::cout << "\t--vectorize-report\tprint to stderr which loops were vectorized, and why the others were\n";
+    std::cout << "\t\t\t\tnot. Not available when linking infiles into one executable.\n";
+    std::cout << "\t--line-buffered\t\tflush program output at every newline (default: only when stdout\n";
+    std::cout << "\t\t\t\tis a terminal, otherwise when the buffer fills up and at exit).\n";
+    std::cout << "\t--time-report[=json]\tprint wall time, CPU time and peak memory of each stage to stderr.\n";
+    std::cout << "\t--cache\t\t\treuse executables of identical earlier compiles ($CPLUS_CACHE_DIR,\n";
+    std::cout << "\t\t\t\tdefault ~/.cache/cplus).\n";
+    std::cout << "\t--serve\t\t\tcompile server: read one job (\"[options] infile\") per line from stdin\n";
+    std::cout << "\t\t\t\tand reply \"<exit code> <job>\" on stdout.\n";
     std::exit(1);
 }
 
-int Shell::parse_args(int argc, char **argv) {
+// Parses the value of a numeric option into out. Prints an error unless it is an integer in [min, max].
+static bool parse_integer(const std::string &option, const char *value, long long min, long long max, long long &out) {
+    if (!value || llvm::StringRef(value).getAsInteger(10, out) || out < min || out > max) {
+        std::cout << "Error: " << option << " takes an integer from " << min << " to " << max << '\n';
+        return false;
+    }
+    return true;
+}
+
+// Later features override earlier ones, so -mattr can amend -march=native.
+void Options::add_features(const std::string &list) {
+    if (!list.empty()) {
+        features += (features.empty() ? "" : ",") + list;
+    }
+}
+
+int Options::parse_args(int argc, char **argv) {
+    bool object = false, assembly = false, emit_llvm = false;
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
         if (arg == "--help" || arg == "-h") {
@@ -35,21 +132,163 @@ int Shell::parse_args(int argc, char **argv) {
             debug = true;
         }
         else if (arg == "-o" || arg == "--outfile") {
+            if (i + 1 >= argc) {
+                std::cout << "Error: " << arg << " takes a file name\n";
+                return 1;
+            }
             outfile = argv[++i];
             continue;
         }
+        else if (arg == "-c" || arg == "-emit-obj") {
+            object = true;
+        }
+        else if (arg == "-S") {
+            assembly = true;
+        }
+        else if (arg == "-emit-llvm") {
+            emit_llvm = true;
+        }
+        else if (arg == "-emit-llvm-bc") {
+            object = emit_llvm = true;
+        }
+        else if (arg == "--time-report" || arg == "--time-report=json") {
+            time_report = true;
+            time_report_json = arg == "--time-report=json";
+        }
+        else if (arg == "--cache") {
+            cache = true;
+        }
+        else if (arg == "--bounds-check") {
+            bounds_check = true;
+        }
+        else if (arg == "--vectorize-report") {
+            vectorize_report = true;
+        }
+        else if (arg == "--always-inline") {
+            always_inline = true;
+        }
+        else if (arg.rfind("--inline-threshold=", 0) == 0) {
+            long long value;
+            if (!parse_integer("--inline-threshold", arg.c_str() + 19, 0, std::numeric_limits<int>::max(), value)) {
+                return 1;
+            }
+            inline_threshold = value;
+        }
+        else if (arg == "--profile-generate") {
+            profile_generate = "default_%m.profraw";
+        }
+        else if (arg.rfind("--profile-generate=", 0) == 0) {
+            profile_generate = arg.substr(19);
+        }
+        else if (arg.rfind("--profile-use=", 0) == 0) {
+            profile_use = arg.substr(14);
+        }
+        else if (arg == "--line-buffered") {
+            line_buffered = true;
+        }
+        else if (arg == "--serve") {
+            serve = true;
+        }
+        else if (arg == "-r" || arg == "--run") {
+            run = true;
+        }
+        else if (arg.size() == 3 && arg[0] == '-' && arg[1] == 'O' && arg[2] >= '0' && arg[2] <= '3') {
+            opt_level = arg[2] - '0';
+        }
+        else if (arg == "-march=native" || arg == "-mcpu=native") {
+            cpu = llvm::sys::getHostCPUName().str();
+            llvm::StringMap<bool> host;
+            if (llvm::sys::getHostCPUFeatures(host)) {
+                std::vector<std::string> list;
+                for (auto& feature : host) {
+                    list.push_back((feature.second ? "+" : "-") + feature.first().str());
+                }
+                std::sort(list.begin(), list.end()); // a stable string for the cache key
+                add_features(llvm::join(list, ","));
+            }
+        }
+        else if (arg.rfind("-march=", 0) == 0 || arg.rfind("-mcpu=", 0) == 0) {
+            cpu = arg.substr(arg.find('=') + 1);
+        }
+        else if (arg.rfind("-mattr=", 0) == 0) {
+            add_features(arg.substr(7));
+        }
+        else if (arg == "-j" || arg == "--jobs") {
+            long long value;
+            if (!parse_integer(arg, i + 1 < argc ? argv[++i] : nullptr, 0, std::numeric_limits<unsigned>::max(), value)) {
+                return 1;
+            }
+            jobs = value;
+            continue;
+        }
+        else if (arg == "--partitions") {
+            long long value;
+            if (!parse_integer(arg, i + 1 < argc ? argv[++i] : nullptr, 1, 1024, value)) {
+                return 1;
+            }
+            partitions = value;
+            continue;
+        }
         else {
-            infile.open(arg);
-            if (!infile.good()) {
+            if (!llvm::sys::fs::exists(arg)) {
                 std::cout << "Error: no such file: " << arg << '\n';
                 return 1;
             }
-            readFrom(&infile);
+            auto extension = llvm::sys::path::extension(arg);
+            if (extension == ".o" || extension == ".a") {
+                objects.push_back(arg);
+            }
+            else if (extension == ".bc" || extension == ".ll") {
+                bitcode.push_back(arg);
+            }
+            else {
+                infiles.push_back(arg);
+            }
         }
     }
-    if (!infile.is_open()) {
+    if (assembly) {
+        emit = emit_llvm ? Emit::IR : Emit::ASSEMBLY;
+    }
+    else if (object) {
+        emit = emit_llvm ? Emit::BITCODE : Emit::OBJECT;
+    }
+    else if (emit_llvm) {
+        std::cout << "Error: -emit-llvm needs -S or -c\n";
+        return 1;
+    }
+
+    if (infiles.empty() && !links() && !serve) {
         show_help();
     }
+    if (links() && (run || emit != Emit::EXECUTABLE)) {
+        std::cout << "Error: infiles linked into one executable cannot be combined with -r, -c, -S or -emit-llvm-bc\n";
+        return 1;
+    }
+    if (links() && vectorize_report) {
+        // Loops are vectorized after linking, where the report cannot tell which infile each came from
+        std::cout << "Error: --vectorize-report takes infiles compiled separately, not linked into one executable\n";
+        return 1;
+    }
+    if (infiles.size() > 1 && run) {
+        std::cout << "Error: -r/--run takes a single infile\n";
+        return 1;
+    }
+    if (run && emit != Emit::EXECUTABLE) {
+        std::cout << "Error: -r/--run cannot be combined with -c, -S or -emit-llvm-bc\n";
+        return 1;
+    }
+    if (!profile_generate.empty() && (run || !profile_use.empty())) {
+        std::cout << "Error: --profile-generate cannot be combined with " << (run ? "-r/--run" : "--profile-use") << '\n';
+        return 1;
+    }
+    // LLVM aborts the whole process on an unreadable profile, so it is checked up front.
+    if (!profile_use.empty()) {
+        auto reader = llvm::IndexedInstrProfReader::create(profile_use);
+        if (!reader) {
+            std::cout << "Error: cannot read profile " << profile_use << ": " << llvm::toString(reader.takeError()) << '\n';
+            return 1;
+        }
+    }
     return 0;
 }
 
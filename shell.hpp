@@ -1,29 +1,79 @@
 #ifndef SHELL_H
 #define SHELL_H
 
-#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <llvm/Support/MemoryBuffer.h>
 
 #include "lexer.h"
 #include "parser.hpp"
+#include "report.hpp"
 
 namespace cplus {
-class Shell {
+
+// What a compilation writes
+enum class Emit { EXECUTABLE, OBJECT, ASSEMBLY, BITCODE, IR };
+
+// Command line options. Parsed once and shared read-only by every compilation of the invocation.
+class Options {
+public:
+    bool debug = false;
+    int opt_level = 0;
+    bool run = false;
+    bool serve = false;
+    bool cache = false;
+    bool time_report = false;
+    bool time_report_json = false;
+    bool line_buffered = false; // flush program output at every newline
+    bool bounds_check = false;  // check array indices at run time
+    bool vectorize_report = false;
+    bool always_inline = false;  // inline routines become alwaysinline
+    int inline_threshold = -1;   // -1: the -O level's default
+    std::string profile_generate; // raw profile the instrumented program writes
+    std::string profile_use;      // indexed profile (llvm-profdata merge) to optimize with
+    std::string cpu = "generic"; // -mcpu/-march
+    std::string features;        // -mattr, e.g. "+avx2,-fma"
+    unsigned jobs = 0;       // 0: one per hardware thread
+    unsigned partitions = 1; // codegen threads per compilation
+    Emit emit = Emit::EXECUTABLE;
+    std::vector<std::string> infiles;   // sources
+    std::vector<std::string> objects;   // .o and .a infiles, passed to the linker
+    std::vector<std::string> bitcode;   // .bc and .ll infiles, linked into one module with the sources
+    std::string outfile; // empty: a.out, or one output per infile named after it
+    bool link_module = false; // a module compiled for linking, optimized again as part of the linked whole
+
+    int parse_args(int argc, char **argv);
+    void show_help();
+    // Whether the infiles are linked into one executable: some are not sources, or several are given one outfile
+    bool links() const { return !objects.empty() || !bitcode.empty() || (infiles.size() > 1 && !outfile.empty()); }
+
+private:
+    void add_features(const std::string &list);
+};
+
+// State of a single compilation (source, lexer, parser, AST, time report).
+// Compilations share nothing mutable, so several may run on different threads.
+class Shell : public Options {
 public:
-    Shell();
+    Shell(const Options &options, const std::string &infile);
 
     friend class Parser;
     friend class Lexer;
 
-    bool debug = false;
-    std::ifstream infile;
-    std::string outfile = "a.out";
+    TimeReport report;
+    double lexing_ms = 0; // wall time spent in the lexer, summed per token under --time-report
+    std::string infile;
+    std::unique_ptr<llvm::MemoryBuffer> source; // memory-mapped when large enough
+    std::unique_ptr<ast::Program> program;      // owns the whole program (and its node arena)
 
+    int open();
     int parse_program();
-    int parse_args(int argc, char **argv);
     int print_ast();
-    void readFrom(std::istream *is);
-    void show_help();
-    
+    void readFrom(const llvm::MemoryBuffer &buffer);
+    unsigned line(size_t offset) const; // 1-based line of a source offset
+
 private:
     Lexer lexer;
     Parser parser;
@@ -0,0 +1,47 @@
+# For loops: bounds are evaluated once, reverse loops count down from the last value
+
+var calls : integer;
+
+routine bound(n : integer) : integer is
+    calls := calls + 1;
+    return n;
+end
+
+routine main() : integer is
+    var n is 3;
+    for i in 1 .. n loop
+        n := n + 1;
+        print i;
+        print " ";
+    end
+    println n;
+
+    for i in 1 .. bound(4) loop
+        print i;
+        print " ";
+    end
+    println calls;
+
+    for i in reverse 1 .. 3 loop
+        print i;
+        print " ";
+    end
+    println "";
+
+    for i in reverse bound(2) .. bound(5) loop
+        print i;
+        print " ";
+    end
+    println calls;
+
+    var empty is 0;
+    for i in 3 .. 1 loop
+        empty := empty + 1;
+    end
+    for i in reverse 3 .. 1 loop
+        empty := empty + 1;
+    end
+    println empty;
+
+    return 0;
+end
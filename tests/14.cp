@@ -0,0 +1,19 @@
+# Constant folding of mixed integer and real expressions
+
+var three is 3;
+var half is 0.5;
+var negative is -3;
+
+routine main() : integer is
+    println -3 + 0.5;
+    println negative + half;
+    println negative * half;
+    println 7 / 2;
+    println 7 / 2.0;
+    println three * 2 - 10;
+    println (1 + 2) * 1.5;
+    println -7 % 3;
+    println 2 < 2.5;
+    println negative > -3.5;
+    return 0;
+end
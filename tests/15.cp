@@ -0,0 +1,28 @@
+# Arrays are indexed from 1: array[n] has elements 1 to n
+
+type vector is array[5] integer;
+
+var squares : vector;
+
+routine main() : integer is
+    for i in 1 .. 5 loop
+        squares[i] := i * i;
+    end
+    println squares[1];
+    println squares[5];
+
+    var n is 4;
+    var local : array[n] real;
+    for i in 1 .. n loop
+        local[i] := i / 2.0;
+    end
+    println local[1];
+    println local[n];
+
+    var sum is 0;
+    for i in reverse 1 .. 5 loop
+        sum := sum + squares[i];
+    end
+    println sum;
+    return 0;
+end
@@ -0,0 +1,15 @@
+# cplus: --bounds-check
+# An index past the end stops the program after the output printed so far
+
+routine main() : integer is
+    var a : array[3] integer;
+    for i in 1 .. 3 loop
+        a[i] := i * 10;
+    end
+    println a[3];
+
+    var i is 4;
+    println a[i];
+    println "not reached";
+    return 0;
+end
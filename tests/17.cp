@@ -0,0 +1,32 @@
+# Conversions between integers, booleans and reals
+
+routine is_odd(n : integer) : boolean is
+    return n % 2;
+end
+
+routine main() : integer is
+    var t is true;
+    var n is 5;
+    println t + 1;
+    println n and t;
+    println 0 or false;
+    println 12 and 10;
+    println 12 or 10;
+    println 12 xor 10;
+    println is_odd(n);
+    println is_odd(4);
+    println is_odd(n) > is_odd(4);
+    println is_odd(n) <= is_odd(4);
+
+    var b : boolean is 0.5;
+    var i : integer is t;
+    var r : real is t;
+    println b;
+    println i;
+    println r;
+
+    if n then
+        println "non-zero";
+    end
+    return 0;
+end
@@ -0,0 +1,17 @@
+# cplus: modules/shapes.cp -o a.out
+# Two sources linked into one executable: routines declared without a body are defined in the other
+
+routine square(x : integer) : integer;
+routine area(r : real) : real;
+routine report();
+
+var count is 100;
+
+routine main() : integer is
+    println square(7);
+    println square(count);
+    println area(2);
+    report();
+    println count;
+    return 0;
+end
@@ -0,0 +1,16 @@
+# Routines linked into test 18
+
+var count is 0;
+
+routine square(x : integer) : integer is
+    count := count + 1;
+    return x * x;
+end
+
+routine area(r : real) : real is
+    return 3.0 * r * r;
+end
+
+routine report() is
+    println count;
+end
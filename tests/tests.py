@@ -9,6 +9,16 @@ PROGRAM_NAME = "./a.out"
 
 SOURCE_EXT = ".cp" # file extension to distinguish test source files from...
 ANSWER_EXT = ".ans" # expected results
+OPTIONS_PREFIX = "# cplus:" # a test source may list extra compiler arguments on its first line
+MODULES_DIR = "modules" # sources that tests link with, not tests themselves
+
+def compiler_options(source):
+    with open(source) as file:
+        line = file.readline()
+    if not line.startswith(OPTIONS_PREFIX):
+        return []
+    # sources to link with are relative to the test
+    return [os.path.join(os.path.dirname(source), arg) if arg.endswith(SOURCE_EXT) else arg for arg in line[len(OPTIONS_PREFIX):].split()]
 
 class ExampleTest(unittest.TestCase):
     cases = []
@@ -38,7 +48,7 @@ class ExampleTest(unittest.TestCase):
                     program_name = PROGRAM_NAME                
                 try:
                     # run Cplus compiler
-                    subprocess.check_call(args=[f"{compiler_name}", f"./{example + SOURCE_EXT}"], stdin=None, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, shell=False)
+                    subprocess.check_call(args=[f"{compiler_name}", f"./{example + SOURCE_EXT}"] + compiler_options(example + SOURCE_EXT), stdin=None, stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, shell=False)
 
                     # run generated program and write its output to "out.txt"
                     with open("out.txt", "w") as actual:
@@ -74,6 +84,8 @@ if __name__ == "__main__":
     
     # traverse test directry and discover test cases
     for root, dirs, files in os.walk(test_dir):
+        if MODULES_DIR in dirs:
+            dirs.remove(MODULES_DIR)
         # only "*.cp" files are test case sources
         for case in filter(lambda name : name.endswith(SOURCE_EXT), files):
             test_name = os.path.splitext(root + case)[0]